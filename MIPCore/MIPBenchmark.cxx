@@ -0,0 +1,154 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPBenchmark.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPBenchmark - timing driver for the MIPCore kernels
+// .SECTION Description
+// Generates a random particle cloud in the unit cube and times the
+// projection and colour mapping stages for a set of image resolutions
+// and thread counts, without any ParaView/OpenGL overhead. The projection
+// is timed in generation order, with tile binning and after Z-order
+// sorting, then once with each accumulation operator.
+//
+// Usage : MIPBenchmark [particles=10000000] [frames=5]
+
+#include "MIPProjection.h"
+#include "MIPColourMap.h"
+#include "MIPMorton.h"
+#include "MIPOperator.h"
+#include "MIPSynthetic.h"
+#include "MIPTransform.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//----------------------------------------------------------------------------
+static double MIPBenchmarkSeconds()
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+//----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  MIPIdType N = (argc>1) ? atoll(argv[1]) : 10000000;
+  int frames  = (argc>2) ? atoi(argv[2]) : 5;
+  //
+  // deterministic uniform cloud, float positions and scalars
+  //
+  std::vector<float> points(N*3), scalars(N);
+  std::mt19937 rng(12345);
+  const float norm = 1.0f/16777216.0f;
+  for (MIPIdType i=0; i<N; i++) {
+    points[i*3+0] = (rng() >> 8)*norm;
+    points[i*3+1] = (rng() >> 8)*norm;
+    points[i*3+2] = (rng() >> 8)*norm;
+    scalars[i]    = (rng() >> 8)*norm;
+  }
+  MIPColourTable table;
+  MIPSyntheticGreyTable(table);
+  const unsigned char background[4] = {0, 0, 0, 255};
+  //
+  // the same particles sorted along the Z-order curve
+  //
+  double tm0 = MIPBenchmarkSeconds();
+  std::vector<MIPIdType> order;
+  MIPMortonOrder(&points[0], N, order);
+  std::vector<float> mpoints(N*3), mscalars(N);
+  MIPGatherTuples(&points[0], 3, &order[0], N, &mpoints[0]);
+  MIPGatherTuples(&scalars[0], 1, &order[0], N, &mscalars[0]);
+  double tm1 = MIPBenchmarkSeconds();
+
+  int maxThreads = 1;
+#ifdef _OPENMP
+  maxThreads = omp_get_max_threads();
+#endif
+  const int resolutions[][2] = { {512,512}, {1920,1080}, {3840,2160}, {7680,4320} };
+  printf("transform kernel : %s\n", MIPTransformInstructionSet());
+  printf("morton sort      : %.3f s\n", tm1-tm0);
+  printf("%-12s %8s %14s %14s %14s %14s %14s %10s\n", "image", "threads",
+    "project ms", "Mparticles/s", "colour ms", "binned ms", "morton ms", "speedup");
+  for (int r=0; r<4; r++) {
+    int X = resolutions[r][0], Y = resolutions[r][1];
+    MIPView view;
+    MIPSyntheticView(X, Y, view);
+    std::vector<double> image(static_cast<size_t>(X)*Y);
+    std::vector<unsigned char> rgb(static_cast<size_t>(X)*Y*3);
+    for (int threads=1; ; threads = std::min(threads*2, maxThreads)) {
+      MIPSyntheticSetThreads(threads);
+      double tproject = 0, tcolour = 0, tbinned = 0, tmorton = 0;
+      for (int f=0; f<frames; f++) {
+        double t0 = MIPBenchmarkSeconds();
+        MIPClearImage(&image[0], image.size());
+        MIPProjectPoints(view, &points[0], &scalars[0], 1, N, &image[0]);
+        double t1 = MIPBenchmarkSeconds();
+        MIPColourMapImage(&image[0], image.size(), table, background, 3, &rgb[0]);
+        double t2 = MIPBenchmarkSeconds();
+        MIPClearImage(&image[0], image.size());
+        MIPProjectPoints(view, &mpoints[0], &mscalars[0], 1, N, &image[0]);
+        double t3 = MIPBenchmarkSeconds();
+        MIPView binned = view;
+        binned.TileBinning = true;
+        MIPClearImage(&image[0], image.size());
+        MIPProjectPoints(binned, &points[0], &scalars[0], 1, N, &image[0]);
+        double t4 = MIPBenchmarkSeconds();
+        tproject += t1-t0;
+        tcolour  += t2-t1;
+        tmorton  += t3-t2;
+        tbinned  += t4-t3;
+      }
+      tproject /= frames;
+      tcolour  /= frames;
+      tmorton  /= frames;
+      tbinned  /= frames;
+      char name[32];
+      snprintf(name, sizeof(name), "%dx%d", X, Y);
+      printf("%-12s %8d %14.3f %14.2f %14.3f %14.3f %14.3f %10.2f\n", name, threads,
+        tproject*1000.0, N/tproject/1.0e6, tcolour*1000.0, tbinned*1000.0,
+        tmorton*1000.0, tproject/tmorton);
+      if (threads==maxThreads) break;
+    }
+  }
+  //
+  // the accumulation operators at full HD with all threads
+  //
+  const char *operators[] = { "max", "min", "sum", "mean", "count" };
+  MIPView view;
+  MIPSyntheticView(1920, 1080, view);
+  std::vector<double> image(1920*1080);
+  printf("%-12s %14s\n", "operator", "project ms");
+  for (int op=MIP_OPERATOR_MAX; op<=MIP_OPERATOR_COUNT; op++) {
+    if (op==MIP_OPERATOR_MEAN) {
+      // two sum projections, see vtkMIPPainter
+      continue;
+    }
+    view.Operator = op;
+    double tproject = 0;
+    for (int f=0; f<frames; f++) {
+      double t0 = MIPBenchmarkSeconds();
+      MIPClearImage(&image[0], image.size(), MIPOperatorEmpty(op));
+      MIPProjectPoints(view, &points[0], &scalars[0], 1, N, &image[0]);
+      tproject += MIPBenchmarkSeconds()-t0;
+    }
+    printf("%-12s %14.3f\n", operators[op], tproject/frames*1000.0);
+  }
+  return 0;
+}
@@ -0,0 +1,67 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPBuffer.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPBuffer.h"
+
+#include <new>
+#include <stdlib.h>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+#define MIP_BUFFER_ALIGNMENT 64
+
+//----------------------------------------------------------------------------
+void *MIPAllocateAligned(size_t bytes)
+{
+#if defined(_MSC_VER)
+  void *data = _aligned_malloc(bytes, MIP_BUFFER_ALIGNMENT);
+#else
+  void *data = NULL;
+  if (posix_memalign(&data, MIP_BUFFER_ALIGNMENT, bytes)!=0) {
+    data = NULL;
+  }
+#endif
+  if (!data) {
+    throw std::bad_alloc();
+  }
+  return data;
+}
+//----------------------------------------------------------------------------
+void MIPFreeAligned(void *data)
+{
+#if defined(_MSC_VER)
+  _aligned_free(data);
+#else
+  free(data);
+#endif
+}
+//----------------------------------------------------------------------------
+// The loops are kept trivial so the compilers turn them into vector stores,
+// the partition is the one of all the per pixel loops of MIPCore.
+void MIPFillBuffer(double *data, MIPIdType n, double value)
+{
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<n; i++) {
+    data[i] = value;
+  }
+}
+//----------------------------------------------------------------------------
+void MIPFillBuffer(unsigned char *data, MIPIdType n, unsigned char value)
+{
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<n; i++) {
+    data[i] = value;
+  }
+}
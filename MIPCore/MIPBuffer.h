@@ -0,0 +1,110 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPBuffer.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPBuffer - persistent image buffers placed by first touch
+// .SECTION Description
+// The image sized buffers of a frame are kept from one frame to the next
+// and only reallocated when their size (the viewport) changes. Fresh
+// storage is cache line aligned and written for the first time by a
+// parallel loop with the static schedule of the pixel loops (clearing,
+// compositing merges, colour mapping), so on NUMA nodes every page lands
+// on the node of the thread that will walk it. Later frames only refill
+// the buffers, with the same partition.
+//
+// .SECTION See Also
+// vtkMIPPainter MIPProjection
+
+#ifndef __MIPBuffer_h
+#define __MIPBuffer_h
+
+#include "MIPProjection.h"
+
+#include <algorithm>
+
+// Description:
+// Cache line aligned storage, freed with MIPFreeAligned (NULL is ignored).
+void *MIPAllocateAligned(size_t bytes);
+void  MIPFreeAligned(void *data);
+
+// Description:
+// data[0..n-1] = value, in parallel with a static schedule.
+void MIPFillBuffer(double *data, MIPIdType n, double value);
+void MIPFillBuffer(unsigned char *data, MIPIdType n, unsigned char value);
+
+//----------------------------------------------------------------------------
+// Description:
+// An uninitialized array of n values, T is double or unsigned char.
+template <typename T>
+class MIPBuffer
+{
+public:
+  MIPBuffer() : Values(NULL), Size(0) {}
+  ~MIPBuffer() { MIPFreeAligned(this->Values); }
+
+  // Description:
+  // Make the buffer n values long, new storage is first touched with value.
+  // Returns true if the buffer was reallocated.
+  bool Allocate(MIPIdType n, T value)
+  {
+    if (n==this->Size && this->Values) {
+      return false;
+    }
+    this->Release();
+    this->Values = static_cast<T*>(MIPAllocateAligned(std::max<MIPIdType>(n, 1)*sizeof(T)));
+    this->Size   = n;
+    MIPFillBuffer(this->Values, n, value);
+    return true;
+  }
+
+  // Description:
+  // Make the buffer n values long, all set to value.
+  void Reset(MIPIdType n, T value)
+  {
+    if (!this->Allocate(n, value)) {
+      MIPFillBuffer(this->Values, n, value);
+    }
+  }
+
+  void Release()
+  {
+    MIPFreeAligned(this->Values);
+    this->Values = NULL;
+    this->Size   = 0;
+  }
+
+  T        *GetData() { return this->Values; }
+  MIPIdType GetSize() const { return this->Size; }
+
+private:
+  MIPBuffer(const MIPBuffer&);     // Not implemented.
+  void operator=(const MIPBuffer&); // Not implemented.
+
+  T        *Values;
+  MIPIdType Size;
+};
+
+//----------------------------------------------------------------------------
+// Description:
+// The buffers of a frame of vtkMIPPainter : the local image (and weights
+// of the mean), the composited image (and weights) and the RGB pixels.
+struct MIPFrameBuffers
+{
+  MIPBuffer<double>        Values;
+  MIPBuffer<double>        Weights;
+  MIPBuffer<double>        Collected;
+  MIPBuffer<double>        CollectedWeights;
+  MIPBuffer<unsigned char> Colours;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#--------------------------------------------------
+# Runs MIPCheckProjection (CHECK) with each MIP_SIMD
+# instruction set, all must print the same digest.
+# Sets the CPU cannot run fall back to the best one
+# it has, so they are compared too.
+# Usage : cmake -DCHECK=<MIPCheckProjection> -P MIPCheckProjection.cmake
+#--------------------------------------------------
+IF (NOT CHECK)
+  MESSAGE(FATAL_ERROR "CHECK must give the path to MIPCheckProjection")
+ENDIF (NOT CHECK)
+
+SET(REFERENCE "")
+FOREACH (ISA scalar avx2 avx512)
+  SET(ENV{MIP_SIMD} ${ISA})
+  EXECUTE_PROCESS(COMMAND ${CHECK}
+    RESULT_VARIABLE RESULT
+    OUTPUT_VARIABLE OUTPUT
+  )
+  STRING(STRIP "${OUTPUT}" OUTPUT)
+  MESSAGE(STATUS "MIP_SIMD=${ISA} : ${OUTPUT}")
+  IF (NOT RESULT EQUAL 0)
+    MESSAGE(FATAL_ERROR "MIPCheckProjection failed with MIP_SIMD=${ISA}")
+  ENDIF (NOT RESULT EQUAL 0)
+  STRING(REGEX MATCH "digest [0-9a-f]+" DIGEST "${OUTPUT}")
+  IF (NOT DIGEST)
+    MESSAGE(FATAL_ERROR "No digest from MIPCheckProjection")
+  ENDIF (NOT DIGEST)
+  IF (NOT REFERENCE)
+    SET(REFERENCE "${DIGEST}")
+  ELSEIF (NOT DIGEST STREQUAL REFERENCE)
+    MESSAGE(FATAL_ERROR "MIP_SIMD=${ISA} gives ${DIGEST}, scalar gives ${REFERENCE}")
+  ENDIF (NOT REFERENCE)
+ENDFOREACH (ISA)
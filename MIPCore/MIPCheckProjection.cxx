@@ -0,0 +1,226 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPCheckProjection.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPCheckProjection - check that the projection kernels agree
+// .SECTION Description
+// Transforms and projects a cloud (float and double positions, with
+// particles outside the image and behind the camera) with perspective and
+// orthographic cameras, axis aligned and rotated, and prints a digest of
+// the pixel coordinates and images. The instruction set is the one
+// MIPTransformPoints selects, so running it with each MIP_SIMD setting (see
+// MIPCheckProjection.cmake) checks that all variants give the same pixels :
+// a change of operation order, FMA contraction or rounding in one of them
+// changes its digest.
+// Random points almost never fall within rounding of a pixel edge, so the
+// cloud also holds points solved to lie on the edges, and their
+// neighbouring floats and doubles.
+// Each projection is also run with and without tile binning, on 1 and 4
+// threads, which must all give the same image.
+// Returns non zero on failure.
+//
+// Usage : MIPCheckProjection
+
+#include "MIPOperator.h"
+#include "MIPProjection.h"
+#include "MIPSynthetic.h"
+#include "MIPTransform.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+//----------------------------------------------------------------------------
+// FNV-1a, enough to compare runs
+static void MIPCheckDigest(const void *data, size_t bytes, unsigned long long &digest)
+{
+  const unsigned char *b = static_cast<const unsigned char*>(data);
+  for (size_t i=0; i<bytes; i++) {
+    digest = (digest ^ b[i])*1099511628211ULL;
+  }
+}
+//----------------------------------------------------------------------------
+// Rotate the camera about the centre of the cube, so every coefficient of
+// the projector is used (the axis aligned views have zero coefficients,
+// which hide a fused multiply-add)
+static void MIPCheckRotateView(MIPView &view)
+{
+  const double c = cos(0.4), s = sin(0.4), k = 1.0/sqrt(3.0);
+  // rotation about (1,1,1), then translation keeping (0.5,0.5,0.5) fixed
+  double R[4][4] = {
+    {c+(1-c)*k*k,     (1-c)*k*k-s*k,   (1-c)*k*k+s*k,   0.0},
+    {(1-c)*k*k+s*k,   c+(1-c)*k*k,     (1-c)*k*k-s*k,   0.0},
+    {(1-c)*k*k-s*k,   (1-c)*k*k+s*k,   c+(1-c)*k*k,     0.0},
+    {0.0, 0.0, 0.0, 1.0}
+  };
+  for (int i=0; i<3; i++) {
+    R[i][3] = 0.5 - 0.5*(R[i][0] + R[i][1] + R[i][2]);
+  }
+  double m[4][4];
+  for (int i=0; i<4; i++) {
+    for (int j=0; j<4; j++) {
+      m[i][j] = 0.0;
+      for (int k2=0; k2<4; k2++) {
+        m[i][j] += view.Matrix[i][k2]*R[k2][j];
+      }
+    }
+  }
+  memcpy(view.Matrix, m, sizeof(m));
+}
+//----------------------------------------------------------------------------
+// The cameras of the check : perspective and orthographic, axis aligned
+// and rotated
+#define MIP_CHECK_VIEWS 4
+static void MIPCheckView(int v, int X, int Y, MIPView &view)
+{
+  if (v%2) {
+    MIPSyntheticOrthographicView(X, Y, view);
+  }
+  else {
+    MIPSyntheticView(X, Y, view);
+  }
+  if (v>=2) {
+    MIPCheckRotateView(view);
+  }
+}
+//----------------------------------------------------------------------------
+template <typename PT>
+static void MIPCheckTransform(const MIPView &view, const std::vector<PT> &points,
+  unsigned long long &digest)
+{
+  const MIPIdType N = static_cast<MIPIdType>(points.size()/3);
+  MIPProjector proj;
+  MIPInitializeProjector(view, proj);
+  std::vector<int> ix(N), iy(N);
+  MIPTransformPoints(proj, &points[0], N, &ix[0], &iy[0]);
+  // iy is left undefined for the points outside the image
+  for (MIPIdType i=0; i<N; i++) {
+    iy[i] = (ix[i]<0) ? -1 : iy[i];
+  }
+  MIPCheckDigest(&ix[0], N*sizeof(int), digest);
+  MIPCheckDigest(&iy[0], N*sizeof(int), digest);
+}
+//----------------------------------------------------------------------------
+// Append n points whose x (then y) projects onto a pixel edge with view,
+// each followed by the 2*MIP_CHECK_ULPS values of x (y) around it, in float
+// to pointsF and in double to pointsD. The other coordinates are random.
+#define MIP_CHECK_ULPS 3
+static void MIPCheckEdgePoints(const MIPView &view, int n,
+  std::vector<float> &pointsF, std::vector<double> &pointsD)
+{
+  MIPProjector P;
+  MIPInitializeProjector(view, P);
+  std::vector<float> random(n*3), unused(n);
+  MIPGenerateParticles(MIP_SYNTHETIC_UNIFORM, 11, 0, n, &random[0], &unused[0]);
+  for (int i=0; i<n; i++) {
+    const int c = i%2, o = 1-c;
+    double p[3] = { random[i*3], random[i*3+1], random[i*3+2] };
+    // an edge inside the image, solving Row[c].p/Row[2].p + Offset = edge
+    // for p[c] (w is 1 for orthographic projectors)
+    const double edge = 1.0 + (i*37)%(P.Size[c]-2) - P.Offset[c];
+    const double rest  = p[o]*P.Row[c][o] + p[2]*P.Row[c][2] + P.Row[c][3];
+    const double restW = P.Ortho ? 1.0 : p[o]*P.Row[2][o] + p[2]*P.Row[2][2] + P.Row[2][3];
+    const double wc    = P.Ortho ? 0.0 : P.Row[2][c];
+    p[c] = (edge*restW - rest)/(P.Row[c][c] - edge*wc);
+    float f = static_cast<float>(p[c]);
+    double d = p[c];
+    for (int k=0; k<MIP_CHECK_ULPS; k++) {
+      f = nextafterf(f, -HUGE_VALF);
+      d = nextafter(d, -HUGE_VAL);
+    }
+    for (int k=0; k<=2*MIP_CHECK_ULPS; k++) {
+      for (int j=0; j<3; j++) {
+        pointsF.push_back(j==c ? f : static_cast<float>(p[j]));
+        pointsD.push_back(j==c ? d : p[j]);
+      }
+      f = nextafterf(f, HUGE_VALF);
+      d = nextafter(d, HUGE_VAL);
+    }
+  }
+}
+//----------------------------------------------------------------------------
+// Project directly and via screen tiles, on 1 and 4 threads, into image
+// (the first of them), returns the number of the others that differ.
+template <typename PT>
+static int MIPCheckProject(const MIPView &view, const std::vector<PT> &points,
+  const std::vector<float> &scalars, std::vector<double> &image)
+{
+  const MIPIdType N = static_cast<MIPIdType>(scalars.size());
+  std::vector<double> other(image.size());
+  int differ = 0;
+  for (int binned=0; binned<2; binned++) {
+    for (int threads=1; threads<=4; threads+=3) {
+      MIPView run = view;
+      run.TileBinning = (binned!=0);
+      MIPSyntheticSetThreads(threads);
+      double *out = (binned || threads>1) ? &other[0] : &image[0];
+      MIPClearImage(out, image.size(), MIPOperatorEmpty(view.Operator));
+      MIPProjectPoints(run, &points[0], &scalars[0], 1, N, out);
+      if (out!=&image[0] && memcmp(out, &image[0], image.size()*sizeof(double))!=0) {
+        printf("operator %d %s on %d threads differs from direct on 1\n",
+          view.Operator, binned ? "binned" : "direct", threads);
+        differ++;
+      }
+    }
+  }
+  return differ;
+}
+//----------------------------------------------------------------------------
+int main()
+{
+  const int X = 640, Y = 480;
+  const MIPIdType N = 500000;
+  //
+  // spread over [-0.2, 1.2], some particles behind the perspective camera
+  //
+  std::vector<float> pointsF(N*3), scalars(N);
+  MIPGenerateParticles(MIP_SYNTHETIC_UNIFORM, 7, 0, N, &pointsF[0], &scalars[0]);
+  std::vector<double> pointsD(N*3);
+  for (MIPIdType i=0; i<N*3; i++) {
+    pointsF[i] = pointsF[i]*1.4f - 0.2f;
+    if (i%3==2 && (i/3)%50==0) {
+      pointsF[i] += 3.0f;
+    }
+    pointsD[i] = pointsF[i]*(1.0 + 1.0e-7);
+  }
+  for (int v=0; v<MIP_CHECK_VIEWS; v++) {
+    MIPView view;
+    MIPCheckView(v, X, Y, view);
+    MIPCheckEdgePoints(view, 20000, pointsF, pointsD);
+  }
+  scalars.resize(pointsF.size()/3, 0.5f);
+  const MIPIdType npixels = static_cast<MIPIdType>(X)*Y;
+  std::vector<double> image(npixels);
+  unsigned long long digest = 14695981039346656037ULL;
+  int failures = 0;
+  for (int v=0; v<MIP_CHECK_VIEWS; v++) {
+    MIPView view;
+    MIPCheckView(v, X, Y, view);
+    MIPCheckTransform(view, pointsF, digest);
+    MIPCheckTransform(view, pointsD, digest);
+    for (int op=MIP_OPERATOR_MAX; op<=MIP_OPERATOR_COUNT; op++) {
+      if (op==MIP_OPERATOR_MEAN) {
+        continue;
+      }
+      view.Operator = op;
+      for (int d=0; d<2; d++) {
+        failures += d ? MIPCheckProject(view, pointsD, scalars, image) :
+                        MIPCheckProject(view, pointsF, scalars, image);
+        MIPCheckDigest(&image[0], npixels*sizeof(double), digest);
+      }
+    }
+  }
+  printf("instruction set %s digest %016llx\n", MIPTransformInstructionSet(), digest);
+  return failures ? 1 : 0;
+}
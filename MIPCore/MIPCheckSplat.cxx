@@ -0,0 +1,192 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPCheckSplat.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPCheckSplat - check of MIPSplatPoints against a brute force splat
+// .SECTION Description
+// Splats a small cloud with a mix of sub pixel, small and tile spanning
+// footprints, for every kernel, with perspective and orthographic cameras,
+// and compares the images with a reference that tests every pixel of the
+// image against every footprint, one particle after the other. The images
+// must match to rounding (the separable kernels are evaluated as a product
+// of factors, the others exactly). Also checks that particles without a radius
+// land on the pixels of MIPProjectPoints, and that the images do not
+// depend on the number of threads.
+// Returns non zero on failure.
+//
+// Usage : MIPCheckSplat
+
+#include "MIPOperator.h"
+#include "MIPSplat.h"
+#include "MIPSynthetic.h"
+#include "MIPTransform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+//----------------------------------------------------------------------------
+static double MIPCheckKernel(int kernel, double q2)
+{
+  switch (kernel) {
+    case MIP_SPLAT_CUBIC_SPLINE: {
+      double q = sqrt(q2);
+      return (q<0.5) ? 1.0 - 6.0*q2 + 6.0*q2*q : 2.0*(1.0-q)*(1.0-q)*(1.0-q);
+    }
+    case MIP_SPLAT_GAUSSIAN:
+      return exp(-4.5*q2);
+    default:
+      return 1.0;
+  }
+}
+//----------------------------------------------------------------------------
+static void MIPCheckCombine(int op, double &pixel, double v)
+{
+  if (op==MIP_OPERATOR_SUM) {
+    pixel += v;
+  }
+  else if (MIPGreater(v, pixel)) {
+    pixel = v;
+  }
+}
+//----------------------------------------------------------------------------
+// Every particle tested against every pixel of the image. The footprint is
+// the ellipse of radii h times the pixels per world unit of the projector
+// rows (without their component along the view direction), at least a
+// pixel, centred half a pixel left and down of the projected centre.
+// Footprints under a pixel draw the one pixel the centre falls in.
+static void MIPCheckReferenceSplat(const MIPView &view, const float *points,
+  const float *scalars, const float *radii, MIPIdType N, int kernel, double *image)
+{
+  MIPProjector P;
+  MIPInitializeProjector(view, P);
+  const int X = view.Size[0], Y = view.Size[1];
+  const double *w = P.Row[2];
+  const double ww = w[0]*w[0] + w[1]*w[1] + w[2]*w[2];
+  double scale[2];
+  for (int j=0; j<2; j++) {
+    const double *r = P.Row[j];
+    // orthographic projectors have no w row
+    const double d = (ww>0.0) ? (r[0]*w[0] + r[1]*w[1] + r[2]*w[2])/ww : 0.0;
+    double s = 0.0;
+    for (int k=0; k<3; k++) {
+      s += (r[k] - d*w[k])*(r[k] - d*w[k]);
+    }
+    scale[j] = sqrt(s);
+  }
+  for (MIPIdType i=0; i<N; i++) {
+    const double x = points[i*3], y = points[i*3+1], z = points[i*3+2];
+    double fx = x*P.Row[0][0] + y*P.Row[0][1] + z*P.Row[0][2] + P.Row[0][3];
+    double fy = x*P.Row[1][0] + y*P.Row[1][1] + z*P.Row[1][2] + P.Row[1][3];
+    double rx = radii[i]*scale[0], ry = radii[i]*scale[1];
+    if (!P.Ortho) {
+      const double pw = x*P.Row[2][0] + y*P.Row[2][1] + z*P.Row[2][2] + P.Row[2][3];
+      fx = fx/pw + P.Offset[0];
+      fy = fy/pw + P.Offset[1];
+      rx = rx/pw;
+      ry = ry/pw;
+    }
+    const double value = view.Operator==MIP_OPERATOR_COUNT ? 1.0 : scalars[i];
+    if (!(rx>=1.0 || ry>=1.0)) {
+      if (fx>-1.0 && fx<X && fy>-1.0 && fy<Y) {
+        MIPCheckCombine(view.Operator,
+          image[static_cast<int>(fx) + static_cast<int>(fy)*X], value);
+      }
+      continue;
+    }
+    const double sx = 1.0/std::max(rx, 1.0), sy = 1.0/std::max(ry, 1.0);
+    for (int py=0; py<Y; py++) {
+      for (int px=0; px<X; px++) {
+        const double dx = (px - (fx-0.5))*sx, dy = (py - (fy-0.5))*sy;
+        const double q2 = dx*dx + dy*dy;
+        if (q2<=1.0) {
+          MIPCheckCombine(view.Operator, image[px + py*X],
+            value*MIPCheckKernel(kernel, q2));
+        }
+      }
+    }
+  }
+}
+//----------------------------------------------------------------------------
+int main()
+{
+  const int X = 200, Y = 150;
+  const MIPIdType N = 2000;
+  std::vector<float> points(N*3), scalars(N), radii(N), zero(N, 0.0f);
+  MIPGenerateParticles(MIP_SYNTHETIC_UNIFORM, 3, 0, N, &points[0], &scalars[0]);
+  // mostly footprints of a few pixels, some under a pixel, some spanning tiles
+  for (MIPIdType i=0; i<N; i++) {
+    radii[i] = (i%100==0) ? 0.3f : (i%3==0) ? 0.0005f : 0.002f + 0.02f*scalars[(i*7)%N];
+  }
+  const char *kernels[] = { "top hat", "cubic spline", "gaussian" };
+  const MIPIdType npixels = static_cast<MIPIdType>(X)*Y;
+  std::vector<double> image(npixels), reference(npixels), single;
+  int failures = 0;
+  for (int ortho=0; ortho<2; ortho++) {
+    MIPView view;
+    if (ortho) {
+      MIPSyntheticOrthographicView(X, Y, view);
+    }
+    else {
+      MIPSyntheticView(X, Y, view);
+    }
+    const char *camera = ortho ? "orthographic" : "perspective";
+    //
+    // without a radius the particles are the pixels of MIPProjectPoints
+    //
+    MIPClearImage(&reference[0], npixels);
+    MIPProjectPoints(view, &points[0], &scalars[0], 1, N, &reference[0]);
+    MIPClearImage(&image[0], npixels);
+    MIPSplatPoints(view, &points[0], &scalars[0], 1, &zero[0], 1,
+      static_cast<const MIPIdType*>(NULL), N, MIP_SPLAT_CUBIC_SPLINE, &image[0]);
+    if (memcmp(&image[0], &reference[0], npixels*sizeof(double))!=0) {
+      printf("%s : particles without radius differ from MIPProjectPoints\n", camera);
+      failures++;
+    }
+    for (int op=MIP_OPERATOR_MAX; op<=MIP_OPERATOR_SUM; op+=MIP_OPERATOR_SUM) {
+      view.Operator = op;
+      for (int kernel=MIP_SPLAT_TOPHAT; kernel<=MIP_SPLAT_GAUSSIAN; kernel++) {
+        MIPClearImage(&reference[0], npixels, MIPOperatorEmpty(op));
+        MIPCheckReferenceSplat(view, &points[0], &scalars[0], &radii[0], N, kernel,
+          &reference[0]);
+        for (int threads=1; threads<=3; threads+=2) {
+          MIPSyntheticSetThreads(threads);
+          MIPClearImage(&image[0], npixels, MIPOperatorEmpty(op));
+          MIPSplatPoints(view, &points[0], &scalars[0], 1, &radii[0], 1,
+            static_cast<const MIPIdType*>(NULL), N, kernel, &image[0]);
+          if (threads==1) {
+            single = image;
+          }
+          else if (memcmp(&image[0], &single[0], npixels*sizeof(double))!=0) {
+            printf("%s %s : %d threads differ from 1\n", camera, kernels[kernel], threads);
+            failures++;
+          }
+          MIPIdType differ = 0, covered = 0;
+          for (MIPIdType p=0; p<npixels; p++) {
+            const double tolerance = 1.0e-12*std::max(1.0, fabs(reference[p]));
+            differ  += !(fabs(image[p]-reference[p])<=tolerance);
+            covered += (reference[p]!=MIPOperatorEmpty(op));
+          }
+          printf("%-12s %-4s %-12s threads %d : %lld of %lld pixels differ\n", camera,
+            op==MIP_OPERATOR_SUM ? "sum" : "max", kernels[kernel], threads,
+            static_cast<long long>(differ), static_cast<long long>(covered));
+          failures += (differ>0);
+        }
+      }
+    }
+  }
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPColourMap.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPColourMap.h"
+
+#include <cmath>
+#include <cstring>
+
+//----------------------------------------------------------------------------
+void MIPInitializeColourTable(MIPColourTable &table, int size,
+  const double range[2], bool log, std::vector<double> &values)
+{
+  table.Range[0] = range[0];
+  table.Range[1] = range[1];
+  table.Log = log && range[0]>0.0 && range[1]>0.0;
+  table.RGBA.assign(size*4, 0);
+  memset(table.NaN, 0, sizeof(table.NaN));
+  memset(table.Below, 0, sizeof(table.Below));
+  memset(table.Above, 0, sizeof(table.Above));
+  values.resize(size);
+  double lo = table.Log ? log10(range[0]) : range[0];
+  double hi = table.Log ? log10(range[1]) : range[1];
+  double step = (hi-lo)/size;
+  for (int i=0; i<size; i++) {
+    double v = lo + (i+0.5)*step;
+    values[i] = table.Log ? pow(10.0, v) : v;
+  }
+}
+//----------------------------------------------------------------------------
+template <int NC, bool Log>
+static void MIPColourMapT(const double *image, MIPIdType npixels,
+  const MIPColourTable &table, const unsigned char background[4],
+  unsigned char *out)
+{
+  const int size = static_cast<int>(table.RGBA.size()/4);
+  const unsigned char *rgba = &table.RGBA[0];
+  const double lo = Log ? log10(table.Range[0]) : table.Range[0];
+  const double hi = Log ? log10(table.Range[1]) : table.Range[1];
+  const double scale = (hi>lo) ? size/(hi-lo) : 0.0;
+  const double maxIndex = size-1;
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<npixels; i++) {
+    double v = image[i];
+    const unsigned char *c = background;
+    if (v!=MIP_EMPTY_PIXEL) {
+      if (v!=v) {
+        c = table.NaN;
+      }
+      else if (v<table.Range[0]) {
+        c = table.Below;
+      }
+      else if (v>table.Range[1]) {
+        c = table.Above;
+      }
+      else {
+        double f = ((Log ? log10(v) : v) - lo)*scale;
+        // the top of the range (and rounding) lands past the last entry
+        f = (f>0.0) ? ((f<maxIndex) ? f : maxIndex) : 0.0;
+        c = &rgba[static_cast<int>(f)*4];
+      }
+    }
+    unsigned char *o = &out[i*NC];
+    for (int k=0; k<NC; k++) {
+      o[k] = c[k];
+    }
+  }
+}
+//----------------------------------------------------------------------------
+void MIPColourMapImage(const double *image, MIPIdType npixels,
+  const MIPColourTable &table, const unsigned char background[4],
+  int components, unsigned char *out)
+{
+  if (table.RGBA.empty() || npixels<=0) return;
+  if (components==4) {
+    if (table.Log) MIPColourMapT<4, true>(image, npixels, table, background, out);
+    else           MIPColourMapT<4, false>(image, npixels, table, background, out);
+  }
+  else {
+    if (table.Log) MIPColourMapT<3, true>(image, npixels, table, background, out);
+    else           MIPColourMapT<3, false>(image, npixels, table, background, out);
+  }
+}
@@ -0,0 +1,67 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPColourMap.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPColourMap - map a MIP scalar image to RGB(A)
+// .SECTION Description
+// Converts the reduced MIP image into 8 bit colours using a dense table
+// sampled once from the lookup table over the scalar range, linearly or
+// logarithmically. Mapping a pixel is then a range test and a table read,
+// so it is thread safe and runs as a single row-major pass over the image.
+// Empty pixels receive the background colour, NaN and values outside the
+// range the colours of their own slots.
+//
+// .SECTION See Also
+// MIPProjection
+
+#ifndef __MIPColourMap_h
+#define __MIPColourMap_h
+
+#include "MIPProjection.h"
+
+#include <vector>
+
+// Default number of entries of a colour table.
+#define MIP_COLOUR_TABLE_SIZE 4096
+
+//----------------------------------------------------------------------------
+// Description:
+// RGBA entries spread evenly over Range (over log10(Range) if Log), and
+// the colours of NaN and of the values below and above Range (non
+// positive values are below a log range).
+struct MIPColourTable
+{
+  std::vector<unsigned char> RGBA;
+  double                     Range[2];
+  bool                       Log;
+  unsigned char              NaN[4];
+  unsigned char              Below[4];
+  unsigned char              Above[4];
+};
+
+// Description:
+// Prepare a table of size entries and return in values the scalar at the
+// centre of each entry, the caller fills table.RGBA with the colours of
+// these values, and NaN, Below and Above (cleared here; the first and last
+// entries to clamp). Log scale is only used for strictly positive ranges.
+void MIPInitializeColourTable(MIPColourTable &table, int size,
+  const double range[2], bool log, std::vector<double> &values);
+
+// Description:
+// Map npixels image values to out with components (3 or 4) bytes per
+// pixel. Values outside the table range take the Below and Above colours.
+void MIPColourMapImage(const double *image, MIPIdType npixels,
+  const MIPColourTable &table, const unsigned char background[4],
+  int components, unsigned char *out);
+
+#endif
@@ -0,0 +1,107 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPMappedFile.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPMappedFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------
+bool MIPMapFile(const char *filename, MIPMappedFile &file)
+{
+  MIPUnmapFile(file);
+  if (!filename) {
+    return false;
+  }
+#if defined(_WIN32)
+  HANDLE handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (handle==INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(handle, &size) || size.QuadPart==0) {
+    CloseHandle(handle);
+    return false;
+  }
+  HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : NULL;
+  if (!data) {
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(handle);
+    return false;
+  }
+  file.File    = handle;
+  file.Mapping = mapping;
+  file.Size    = static_cast<size_t>(size.QuadPart);
+#else
+  int fd = open(filename, O_RDONLY);
+  if (fd<0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st)!=0 || st.st_size==0) {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE,
+    MAP_PRIVATE, fd, 0);
+  // the mapping keeps the file referenced
+  close(fd);
+  if (data==MAP_FAILED) {
+    return false;
+  }
+  file.Size = static_cast<size_t>(st.st_size);
+#endif
+  file.Data = data;
+  return true;
+}
+//----------------------------------------------------------------------------
+void MIPUnmapFile(MIPMappedFile &file)
+{
+  if (file.Data) {
+#if defined(_WIN32)
+    UnmapViewOfFile(file.Data);
+    CloseHandle(static_cast<HANDLE>(file.Mapping));
+    CloseHandle(static_cast<HANDLE>(file.File));
+#else
+    munmap(file.Data, file.Size);
+#endif
+  }
+  file = MIPMappedFile();
+}
+//----------------------------------------------------------------------------
+void MIPAdviseSequential(const MIPMappedFile &file, size_t offset, size_t size)
+{
+#if !defined(_WIN32) && defined(MADV_WILLNEED)
+  if (!file.Data || offset>=file.Size) {
+    return;
+  }
+  // the advice must start on a page boundary
+  size_t page  = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t start = offset - offset%page;
+  size_t end   = (offset+size<file.Size) ? offset+size : file.Size;
+  madvise(static_cast<char*>(file.Data)+start, end-start, MADV_WILLNEED);
+#else
+  (void)file;
+  (void)offset;
+  (void)size;
+#endif
+}
@@ -0,0 +1,57 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPMappedFile.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPMappedFile - memory mapping of a whole file
+// .SECTION Description
+// Maps a file into memory so that particle arrays can point straight into
+// it : nothing is read until a page is touched, and pages are then shared
+// with the OS file cache rather than copied. The mapping is private (copy
+// on write), writing to it never changes the file.
+//
+// .SECTION See Also
+// vtkMIPMappedParticleSource MIPBuffer
+
+#ifndef __MIPMappedFile_h
+#define __MIPMappedFile_h
+
+#include <stddef.h>
+
+//----------------------------------------------------------------------------
+// Description:
+// A mapped file, Data is NULL when nothing is mapped.
+struct MIPMappedFile
+{
+  void  *Data;
+  size_t Size;
+  // the file and mapping handles on Windows
+  void  *File;
+  void  *Mapping;
+  MIPMappedFile() : Data(NULL), Size(0), File(NULL), Mapping(NULL) {}
+};
+
+// Description:
+// Map the whole file (unmapping file first), returns false if it cannot
+// be opened or mapped, or is empty, leaving file unmapped.
+bool MIPMapFile(const char *filename, MIPMappedFile &file);
+
+// Description:
+// Release the mapping, pointers into it become invalid.
+void MIPUnmapFile(MIPMappedFile &file);
+
+// Description:
+// Hint that bytes [offset, offset+size) of the mapping will be read in
+// order soon, so the OS can read them ahead.
+void MIPAdviseSequential(const MIPMappedFile &file, size_t offset, size_t size);
+
+#endif
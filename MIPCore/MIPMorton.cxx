@@ -0,0 +1,173 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPMorton.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPMorton.h"
+#include "MIPScalars.h"
+
+#include <algorithm>
+#include <cmath>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Bits per radix sort pass, 7 passes cover the 63 bit keys
+#define MIP_RADIX_BITS 9
+
+//----------------------------------------------------------------------------
+// Spread the 21 low bits of v so that there are two zero bits between each
+static inline unsigned long long MIPMortonSpread(unsigned long long v)
+{
+  v &= 0x1fffffULL;
+  v = (v | (v << 32)) & 0x1f00000000ffffULL;
+  v = (v | (v << 16)) & 0x1f0000ff0000ffULL;
+  v = (v | (v <<  8)) & 0x100f00f00f00f00fULL;
+  v = (v | (v <<  4)) & 0x10c30c30c30c30c3ULL;
+  v = (v | (v <<  2)) & 0x1249249249249249ULL;
+  return v;
+}
+//----------------------------------------------------------------------------
+static inline unsigned long long MIPMortonQuantize(double v, double lo, double scale)
+{
+  double q = (v-lo)*scale;
+  // NaN fails the first test
+  if (!(q>0.0)) return 0;
+  if (q>=2097151.0) return 2097151ULL;
+  return static_cast<unsigned long long>(q);
+}
+//----------------------------------------------------------------------------
+// Stable LSD radix sort of (key, id) pairs, every pass is a parallel counting
+// sort where each thread owns a contiguous chunk, as in MIPPartitionByType.
+static void MIPRadixSort(std::vector<unsigned long long> &keys,
+  std::vector<MIPIdType> &ids)
+{
+  const MIPIdType N = static_cast<MIPIdType>(keys.size());
+  const int nbuckets = 1 << MIP_RADIX_BITS;
+  std::vector<unsigned long long> keys2(N);
+  std::vector<MIPIdType> ids2(N);
+  std::vector<MIPIdType> counts;
+  int nchunks = 1;
+#pragma omp parallel
+  {
+#pragma omp single
+    {
+#ifdef _OPENMP
+      nchunks = omp_get_num_threads();
+#endif
+      counts.resize(static_cast<size_t>(nchunks)*nbuckets);
+    }
+    for (int shift=0; shift<63; shift+=MIP_RADIX_BITS) {
+      const unsigned long long *kin = (shift/MIP_RADIX_BITS)%2 ? &keys2[0] : &keys[0];
+      const MIPIdType *iin          = (shift/MIP_RADIX_BITS)%2 ? &ids2[0]  : &ids[0];
+      unsigned long long *kout      = (shift/MIP_RADIX_BITS)%2 ? &keys[0]  : &keys2[0];
+      MIPIdType *iout               = (shift/MIP_RADIX_BITS)%2 ? &ids[0]   : &ids2[0];
+#pragma omp for schedule(static)
+      for (int c=0; c<nchunks; c++) {
+        MIPIdType *count = &counts[static_cast<size_t>(c)*nbuckets];
+        std::fill(count, count+nbuckets, 0);
+        MIPIdType i0 = N*c/nchunks, i1 = N*(c+1)/nchunks;
+        for (MIPIdType i=i0; i<i1; i++) {
+          count[(kin[i] >> shift) & (nbuckets-1)]++;
+        }
+      }
+#pragma omp single
+      {
+        MIPIdType total = 0;
+        for (int b=0; b<nbuckets; b++) {
+          for (int c=0; c<nchunks; c++) {
+            MIPIdType n = counts[static_cast<size_t>(c)*nbuckets + b];
+            counts[static_cast<size_t>(c)*nbuckets + b] = total;
+            total += n;
+          }
+        }
+      }
+#pragma omp for schedule(static)
+      for (int c=0; c<nchunks; c++) {
+        MIPIdType *next = &counts[static_cast<size_t>(c)*nbuckets];
+        MIPIdType i0 = N*c/nchunks, i1 = N*(c+1)/nchunks;
+        for (MIPIdType i=i0; i<i1; i++) {
+          MIPIdType dst = next[(kin[i] >> shift) & (nbuckets-1)]++;
+          kout[dst] = kin[i];
+          iout[dst] = iin[i];
+        }
+      }
+    }
+  }
+  // 7 passes, an odd number, leave the result in the second buffers
+  keys.swap(keys2);
+  ids.swap(ids2);
+}
+//----------------------------------------------------------------------------
+template <typename PT>
+void MIPMortonOrder(const PT *points, MIPIdType N, std::vector<MIPIdType> &order)
+{
+  order.resize(N);
+  if (N==0) {
+    return;
+  }
+  double lo[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL };
+  double hi[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+#pragma omp parallel
+  {
+    double tlo[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL };
+    double thi[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+#pragma omp for schedule(static)
+    for (MIPIdType i=0; i<N; i++) {
+      for (int j=0; j<3; j++) {
+        double v = points[i*3+j];
+        if (v<tlo[j]) tlo[j] = v;
+        if (v>thi[j]) thi[j] = v;
+      }
+    }
+#pragma omp critical
+    for (int j=0; j<3; j++) {
+      lo[j] = std::min(lo[j], tlo[j]);
+      hi[j] = std::max(hi[j], thi[j]);
+    }
+  }
+  double scale[3];
+  for (int j=0; j<3; j++) {
+    double extent = hi[j]-lo[j];
+    scale[j] = (extent>0.0 && extent<HUGE_VAL) ? 2097152.0/extent : 0.0;
+    if (!(lo[j]>-HUGE_VAL)) lo[j] = 0.0;
+  }
+  std::vector<unsigned long long> keys(N);
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<N; i++) {
+    keys[i] =
+      (MIPMortonSpread(MIPMortonQuantize(points[i*3+0], lo[0], scale[0])) << 2) |
+      (MIPMortonSpread(MIPMortonQuantize(points[i*3+1], lo[1], scale[1])) << 1) |
+       MIPMortonSpread(MIPMortonQuantize(points[i*3+2], lo[2], scale[2]));
+    order[i] = i;
+  }
+  MIPRadixSort(keys, order);
+}
+//----------------------------------------------------------------------------
+template <typename T>
+void MIPGatherTuples(const T *in, int C, const MIPIdType *order, MIPIdType N, T *out)
+{
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<N; i++) {
+    const T *src = &in[order[i]*C];
+    T *dst = &out[i*C];
+    for (int c=0; c<C; c++) {
+      dst[c] = src[c];
+    }
+  }
+}
+//----------------------------------------------------------------------------
+template void MIPMortonOrder<float>(const float *, MIPIdType, std::vector<MIPIdType> &);
+template void MIPMortonOrder<double>(const double *, MIPIdType, std::vector<MIPIdType> &);
+#define MIP_INSTANTIATE_GATHER(T) \
+  template void MIPGatherTuples<T>(const T *, int, const MIPIdType *, MIPIdType, T *);
+MIP_FOREACH_SCALAR_TYPE(MIP_INSTANTIATE_GATHER)
@@ -0,0 +1,47 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPMorton.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPMorton - Z-order (Morton) sorting of particles
+// .SECTION Description
+// Simulation output stores particles in an arbitrary order, so consecutive
+// particles land on distant pixels and nearly every max update misses the
+// cache. Sorting the particles along a Z-order curve over their bounds makes
+// consecutive particles spatial neighbours, which project to neighbouring
+// pixels from any camera. The sort is a parallel, stable LSD radix sort of
+// 63 bit keys (21 bits per axis).
+//
+// .SECTION See Also
+// vtkMIPMortonSort MIPProjection
+
+#ifndef __MIPMorton_h
+#define __MIPMorton_h
+
+#include "MIPProjection.h"
+
+#include <vector>
+
+// Description:
+// order[i] = id of the i-th of the N points along the Z-order curve.
+// NaN coordinates are treated as the lower bound of their axis.
+// Instantiated for float/double points.
+template <typename PT>
+void MIPMortonOrder(const PT *points, MIPIdType N, std::vector<MIPIdType> &order);
+
+// Description:
+// out[i] = tuple order[i] of in, for N tuples of C components.
+// Instantiated for all types of MIP_FOREACH_SCALAR_TYPE.
+template <typename T>
+void MIPGatherTuples(const T *in, int C, const MIPIdType *order, MIPIdType N, T *out);
+
+#endif
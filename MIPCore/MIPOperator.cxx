@@ -0,0 +1,59 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPOperator.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPOperator.h"
+
+//----------------------------------------------------------------------------
+double MIPOperatorEmpty(int op)
+{
+  double empty = MIP_EMPTY_PIXEL;
+  MIP_OPERATOR_DISPATCH(op, empty = MIPOp::Empty());
+  return empty;
+}
+//----------------------------------------------------------------------------
+template <typename Op>
+static void MIPMergeImagesT(const double *in, MIPIdType npixels, double *image)
+{
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<npixels; i++) {
+    image[i] = Op::Combine(image[i], in[i]);
+  }
+}
+//----------------------------------------------------------------------------
+void MIPMergeImages(const double *in, MIPIdType npixels, int op, double *image)
+{
+  MIP_OPERATOR_DISPATCH(op, MIPMergeImagesT<MIPOp>(in, npixels, image));
+}
+//----------------------------------------------------------------------------
+void MIPFinalizeImage(double *image, MIPIdType npixels, int op)
+{
+  if (op==MIP_OPERATOR_MAX) {
+    return;
+  }
+  const double empty = MIPOperatorEmpty(op);
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<npixels; i++) {
+    if (image[i]==empty) {
+      image[i] = MIP_EMPTY_PIXEL;
+    }
+  }
+}
+//----------------------------------------------------------------------------
+void MIPMeanImage(double *sum, const double *weight, MIPIdType npixels)
+{
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<npixels; i++) {
+    sum[i] = (weight[i]!=0.0) ? sum[i]/weight[i] : MIP_EMPTY_PIXEL;
+  }
+}
@@ -0,0 +1,188 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPOperator.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPOperator - how particle values are accumulated into pixels
+// .SECTION Description
+// The projection kernels are templated on an operator policy which gives
+// the value of an empty pixel, the contribution of a particle and how two
+// values are combined (serially, atomically, or when merging the images of
+// two processes). All operators are commutative and associative so images
+// can be accumulated in any order and composited with the matching
+// vtkCommunicator reduce operation (MAX_OP, MIN_OP or SUM_OP).
+//
+// The mean is not an operator of its own : it is the ratio of two sum
+// images, the (weighted) values over the weights or the particle count,
+// see MIPMeanImage.
+//
+// After compositing, MIPFinalizeImage marks the pixels no particle reached
+// with MIP_EMPTY_PIXEL, as the colour mapping expects.
+//
+// .SECTION See Also
+// MIPProjection vtkMIPCompositor
+
+#ifndef __MIPOperator_h
+#define __MIPOperator_h
+
+#include "MIPProjection.h"
+
+enum
+{
+  MIP_OPERATOR_MAX   = 0,
+  MIP_OPERATOR_MIN   = 1,
+  MIP_OPERATOR_SUM   = 2,
+  MIP_OPERATOR_MEAN  = 3,
+  MIP_OPERATOR_COUNT = 4
+};
+
+//----------------------------------------------------------------------------
+// Description:
+// Lock-free update pixel = Op::Combine(pixel, value), no write is done when
+// the combined value has the same bits as the pixel.
+template <typename Op>
+inline void MIPAtomicCombine(double *pixel, double value)
+{
+#if defined(_MSC_VER)
+  volatile __int64 *ipixel = reinterpret_cast<volatile __int64 *>(pixel);
+  __int64 current = *ipixel;
+#else
+  unsigned long long *ipixel = reinterpret_cast<unsigned long long *>(pixel);
+  unsigned long long current = __atomic_load_n(ipixel, __ATOMIC_RELAXED);
+#endif
+  for (;;) {
+    double cvalue;
+    memcpy(&cvalue, &current, sizeof(double));
+    double combined = Op::Combine(cvalue, value);
+#if defined(_MSC_VER)
+    __int64 desired;
+    memcpy(&desired, &combined, sizeof(double));
+    if (desired==current) {
+      return;
+    }
+    __int64 previous = _InterlockedCompareExchange64(ipixel, desired, current);
+    if (previous==current) {
+      return;
+    }
+    current = previous;
+#else
+    unsigned long long desired;
+    memcpy(&desired, &combined, sizeof(double));
+    if (desired==current) {
+      return;
+    }
+    // on failure current is updated with the value now stored in the pixel
+    if (__atomic_compare_exchange_n(ipixel, &current, desired, true,
+      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      return;
+    }
+#endif
+  }
+}
+
+//----------------------------------------------------------------------------
+// Description:
+// The operator policies. Value maps a particle scalar to what is
+// accumulated, Accumulate is used by the kernels owning the pixel and
+// AtomicAccumulate by those sharing it.
+struct MIPMaxOperator
+{
+  static const int Id = MIP_OPERATOR_MAX;
+  static double Empty() { return MIP_EMPTY_PIXEL; }
+  static double Value(double v) { return v; }
+  static double Combine(double a, double b) { return MIPGreater(b, a) ? b : a; }
+  static void Accumulate(double &pixel, double v)
+  {
+    if (MIPGreater(v, pixel)) {
+      pixel = v;
+    }
+  }
+  static void AtomicAccumulate(double *pixel, double v) { MIPAtomicMax(pixel, v); }
+};
+
+// Ties between +0 and -0 go to -0, NaN never wins.
+struct MIPMinOperator
+{
+  static const int Id = MIP_OPERATOR_MIN;
+  static double Empty() { return -MIP_EMPTY_PIXEL; }
+  static double Value(double v) { return v; }
+  static double Combine(double a, double b) { return MIPGreater(a, b) ? b : a; }
+  static void Accumulate(double &pixel, double v)
+  {
+    if (MIPGreater(pixel, v)) {
+      pixel = v;
+    }
+  }
+  static void AtomicAccumulate(double *pixel, double v)
+  {
+    MIPAtomicCombine<MIPMinOperator>(pixel, v);
+  }
+};
+
+struct MIPSumOperator
+{
+  static const int Id = MIP_OPERATOR_SUM;
+  static double Empty() { return 0.0; }
+  static double Value(double v) { return v; }
+  static double Combine(double a, double b) { return a + b; }
+  static void Accumulate(double &pixel, double v) { pixel += v; }
+  static void AtomicAccumulate(double *pixel, double v)
+  {
+    MIPAtomicCombine<MIPSumOperator>(pixel, v);
+  }
+};
+
+// Every particle counts 1 whatever its scalar.
+struct MIPCountOperator
+{
+  static const int Id = MIP_OPERATOR_COUNT;
+  static double Empty() { return 0.0; }
+  static double Value(double) { return 1.0; }
+  static double Combine(double a, double b) { return a + b; }
+  static void Accumulate(double &pixel, double v) { pixel += v; }
+  static void AtomicAccumulate(double *pixel, double v)
+  {
+    MIPAtomicCombine<MIPSumOperator>(pixel, v);
+  }
+};
+
+// Description:
+// Expand call with MIPOp typedef'd to the policy of op, max for unknown
+// ones (the mean is accumulated with the sum).
+#define MIP_OPERATOR_DISPATCH(op, call) \
+  switch (op) { \
+    case MIP_OPERATOR_MIN:   { typedef MIPMinOperator   MIPOp; call; break; } \
+    case MIP_OPERATOR_SUM: \
+    case MIP_OPERATOR_MEAN:  { typedef MIPSumOperator   MIPOp; call; break; } \
+    case MIP_OPERATOR_COUNT: { typedef MIPCountOperator MIPOp; call; break; } \
+    default:                 { typedef MIPMaxOperator   MIPOp; call; break; } \
+  }
+
+// Description:
+// Value of an empty pixel while accumulating with op.
+double MIPOperatorEmpty(int op);
+
+// Description:
+// image[i] = Combine(image[i], in[i]) for npixels pixels.
+void MIPMergeImages(const double *in, MIPIdType npixels, int op, double *image);
+
+// Description:
+// Replace the empty pixels of an image accumulated with op by
+// MIP_EMPTY_PIXEL (the pixels of sums and counts that no particle reached
+// are 0, so are sums that cancel out exactly, they show as background).
+void MIPFinalizeImage(double *image, MIPIdType npixels, int op);
+
+// Description:
+// sum[i] = sum[i]/weight[i], or MIP_EMPTY_PIXEL where the weight is 0.
+void MIPMeanImage(double *sum, const double *weight, MIPIdType npixels);
+
+#endif
@@ -0,0 +1,105 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPPartition.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPPartition.h"
+#include "MIPScalars.h"
+
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//----------------------------------------------------------------------------
+template <typename T>
+void MIPNonZeroMask(const T *values, int stride, MIPIdType N, unsigned char *mask)
+{
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<N; i++) {
+    mask[i] = (values[i*stride]!=0) ? 1 : 0;
+  }
+}
+//----------------------------------------------------------------------------
+template <typename T>
+inline int MIPTypeBucket(const T *types, int stride, MIPIdType i, int ntypes)
+{
+  if (!types) return 0;
+  double t = static_cast<double>(types[i*stride]);
+  // NaN and out of range types go to the extra bucket
+  return (t>=0.0 && t<ntypes) ? static_cast<int>(t) : ntypes;
+}
+//----------------------------------------------------------------------------
+// Each thread counts the types of one contiguous chunk of particles, the
+// counts give every (type, chunk) pair its own output range and the chunks
+// are then scattered independently. The result does not depend on the
+// number of threads.
+template <typename T>
+void MIPPartitionByType(const T *types, int stride, const unsigned char *mask,
+  MIPIdType N, int ntypes, MIPTypePartition &partition)
+{
+  const int nbuckets = ntypes+1;
+  partition.NumberOfTypes = ntypes;
+  partition.Offsets.assign(nbuckets+1, 0);
+  std::vector<MIPIdType> counts;
+  int nchunks = 1;
+#pragma omp parallel
+  {
+#pragma omp single
+    {
+#ifdef _OPENMP
+      nchunks = omp_get_num_threads();
+#endif
+      counts.assign(static_cast<size_t>(nchunks)*nbuckets, 0);
+    }
+    // the implicit barrier of single makes counts visible to all threads
+#pragma omp for schedule(static)
+    for (int c=0; c<nchunks; c++) {
+      MIPIdType *count = &counts[static_cast<size_t>(c)*nbuckets];
+      MIPIdType i0 = N*c/nchunks, i1 = N*(c+1)/nchunks;
+      for (MIPIdType i=i0; i<i1; i++) {
+        if (mask && !mask[i]) continue;
+        count[MIPTypeBucket(types, stride, i, ntypes)]++;
+      }
+    }
+#pragma omp single
+    {
+      // exclusive prefix sum in (type, chunk) order
+      MIPIdType total = 0;
+      for (int b=0; b<nbuckets; b++) {
+        partition.Offsets[b] = total;
+        for (int c=0; c<nchunks; c++) {
+          MIPIdType n = counts[static_cast<size_t>(c)*nbuckets + b];
+          counts[static_cast<size_t>(c)*nbuckets + b] = total;
+          total += n;
+        }
+      }
+      partition.Offsets[nbuckets] = total;
+      partition.Index.resize(total);
+    }
+#pragma omp for schedule(static)
+    for (int c=0; c<nchunks; c++) {
+      MIPIdType *next = &counts[static_cast<size_t>(c)*nbuckets];
+      MIPIdType i0 = N*c/nchunks, i1 = N*(c+1)/nchunks;
+      for (MIPIdType i=i0; i<i1; i++) {
+        if (mask && !mask[i]) continue;
+        partition.Index[next[MIPTypeBucket(types, stride, i, ntypes)]++] = i;
+      }
+    }
+  }
+}
+//----------------------------------------------------------------------------
+#define MIP_INSTANTIATE_PARTITION(T) \
+  template void MIPNonZeroMask<T>(const T *, int, MIPIdType, unsigned char *); \
+  template void MIPPartitionByType<T>(const T *, int, const unsigned char *, \
+    MIPIdType, int, MIPTypePartition &);
+MIP_FOREACH_SCALAR_TYPE(MIP_INSTANTIATE_PARTITION)
@@ -0,0 +1,59 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPPartition.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPPartition - particle index partitioned by particle type
+// .SECTION Description
+// Particles of several types (gas, stars, dark matter ...) are usually
+// interleaved in the point arrays. Rather than testing the type and active
+// flag of every particle on every frame, the ids of the particles are
+// sorted by type once (a stable, parallel counting sort) and the render
+// then only walks the ranges of the types that are switched on.
+//
+// .SECTION See Also
+// MIPProjection vtkMIPPainter
+
+#ifndef __MIPPartition_h
+#define __MIPPartition_h
+
+#include "MIPProjection.h"
+
+#include <vector>
+
+//----------------------------------------------------------------------------
+// Description:
+// Ids of the particles grouped by type. The particles of type t are
+// Index[Offsets[t]] .. Index[Offsets[t+1]-1], in increasing id order.
+// Types outside 0..NumberOfTypes-1 are collected in the extra last range
+// t=NumberOfTypes, particles masked out are not in the index at all.
+struct MIPTypePartition
+{
+  int                    NumberOfTypes;
+  std::vector<MIPIdType> Index;
+  std::vector<MIPIdType> Offsets;
+};
+
+// Description:
+// mask[i] = (values[i*stride]!=0) for N values.
+template <typename T>
+void MIPNonZeroMask(const T *values, int stride, MIPIdType N, unsigned char *mask);
+
+// Description:
+// Sort the ids of N particles by their type types[i*stride] (truncated to
+// int). If types is NULL all particles are of type 0. If mask is not NULL,
+// particles with mask[i]==0 are left out.
+template <typename T>
+void MIPPartitionByType(const T *types, int stride, const unsigned char *mask,
+  MIPIdType N, int ntypes, MIPTypePartition &partition);
+
+#endif
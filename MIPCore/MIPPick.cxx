@@ -0,0 +1,185 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPPick.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPPick.h"
+#include "MIPOperator.h"
+#include "MIPScalars.h"
+#include "MIPTransform.h"
+
+#include <algorithm>
+#include <cstring>
+
+//----------------------------------------------------------------------------
+// Lock-free winner = min(winner, id), -1 meaning no winner yet.
+static inline void MIPAtomicMinId(MIPIdType *winner, MIPIdType id)
+{
+#if defined(_MSC_VER)
+  volatile __int64 *iwinner = reinterpret_cast<volatile __int64 *>(winner);
+  __int64 current = *iwinner;
+  for (;;) {
+    if (current>=0 && current<=id) {
+      return;
+    }
+    __int64 previous = _InterlockedCompareExchange64(iwinner, id, current);
+    if (previous==current) {
+      return;
+    }
+    current = previous;
+  }
+#else
+  MIPIdType current = __atomic_load_n(winner, __ATOMIC_RELAXED);
+  for (;;) {
+    if (current>=0 && current<=id) {
+      return;
+    }
+    // on failure current is updated with the value now stored
+    if (__atomic_compare_exchange_n(winner, &current, id, true,
+      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      return;
+    }
+  }
+#endif
+}
+//----------------------------------------------------------------------------
+// The same blocks and transform as MIPProjectPointsT, so every particle
+// lands on the pixel it was accumulated into.
+template <typename Op, typename PT, typename ST>
+static void MIPFindWinnersT(const MIPView &view, const PT *points,
+  const ST *scalars, int stride, const MIPIdType *index, MIPIdType N,
+  const double *image, MIPIdType *winners)
+{
+  MIPProjector proj;
+  MIPInitializeProjector(view, proj);
+  const MIPIdType X = view.Size[0];
+  const MIPIdType nblocks = (N + MIP_TRANSFORM_BLOCK - 1)/MIP_TRANSFORM_BLOCK;
+#pragma omp parallel
+  {
+    int ix[MIP_TRANSFORM_BLOCK], iy[MIP_TRANSFORM_BLOCK];
+    PT gathered[3*MIP_TRANSFORM_BLOCK];
+#pragma omp for schedule(static)
+    for (MIPIdType b=0; b<nblocks; b++) {
+      MIPIdType start = b*MIP_TRANSFORM_BLOCK;
+      MIPIdType n = std::min<MIPIdType>(MIP_TRANSFORM_BLOCK, N-start);
+      if (index) {
+        for (MIPIdType j=0; j<n; j++) {
+          const PT *p = &points[index[start+j]*3];
+          gathered[j*3+0] = p[0];
+          gathered[j*3+1] = p[1];
+          gathered[j*3+2] = p[2];
+        }
+        MIPTransformPoints(proj, gathered, n, ix, iy);
+      }
+      else {
+        MIPTransformPoints(proj, &points[start*3], n, ix, iy);
+      }
+      for (MIPIdType j=0; j<n; j++) {
+        if (ix[j]<0) continue;
+        MIPIdType id = index ? index[start+j] : start+j;
+        double value = Op::Value(scalars ? static_cast<double>(scalars[id*stride]) : 0.0);
+        MIPIdType pixel = ix[j] + iy[j]*X;
+        // compared bitwise, a -0 particle did not make a +0 pixel
+        if (memcmp(&value, &image[pixel], sizeof(double))==0) {
+          MIPAtomicMinId(&winners[pixel], id);
+        }
+      }
+    }
+  }
+}
+//----------------------------------------------------------------------------
+template <typename PT, typename ST>
+void MIPFindWinners(const MIPView &view, const PT *points,
+  const ST *scalars, int stride, const MIPIdType *index, MIPIdType N,
+  const double *image, MIPIdType *winners)
+{
+  if (view.Operator==MIP_OPERATOR_MIN) {
+    MIPFindWinnersT<MIPMinOperator>(view, points, scalars, stride, index, N, image, winners);
+  }
+  else if (view.Operator==MIP_OPERATOR_MAX) {
+    MIPFindWinnersT<MIPMaxOperator>(view, points, scalars, stride, index, N, image, winners);
+  }
+}
+//----------------------------------------------------------------------------
+template <typename PT>
+void MIPMakePickRecords(const MIPView &view, const PT *points,
+  const double *image, const MIPIdType *winners, int rank,
+  MIPIdType npixels, MIPPickRecord *records)
+{
+  const double (*m)[4] = view.Matrix;
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<npixels; i++) {
+    MIPPickRecord &r = records[i];
+    r.Value = image[i];
+    r.Id    = winners[i];
+    r.Rank  = (r.Id>=0) ? rank : -1;
+    r.Depth = 1.0f;
+    if (r.Id>=0) {
+      const PT *p = &points[r.Id*3];
+      double x = p[0], y = p[1], z = p[2];
+      double zn = m[2][0]*x + m[2][1]*y + m[2][2]*z + m[2][3];
+      double w  = m[3][0]*x + m[3][1]*y + m[3][2]*z + m[3][3];
+      // particles outside the near/far planes are drawn too
+      r.Depth = static_cast<float>(std::min(std::max(0.5*zn/w + 0.5, 0.0), 1.0));
+    }
+  }
+}
+//----------------------------------------------------------------------------
+// Ties go to the lowest (id, rank)
+static inline bool MIPPickBefore(const MIPPickRecord &a, const MIPPickRecord &b)
+{
+  return a.Id<b.Id || (a.Id==b.Id && a.Rank<b.Rank);
+}
+//----------------------------------------------------------------------------
+template <typename Op>
+static void MIPMergePickRecordsT(const MIPPickRecord *in, MIPIdType npixels,
+  MIPPickRecord *records)
+{
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<npixels; i++) {
+    const MIPPickRecord &a = in[i];
+    MIPPickRecord &r = records[i];
+    if (a.Id<0) {
+      continue;
+    }
+    // compared bitwise, so +0 beats -0 as in the images
+    double best = Op::Combine(r.Value, a.Value);
+    bool abest = memcmp(&best, &a.Value, sizeof(double))==0;
+    bool rbest = memcmp(&best, &r.Value, sizeof(double))==0;
+    bool wins = (r.Id<0) || (abest && !rbest) || (abest && rbest && MIPPickBefore(a, r));
+    if (wins) {
+      r = a;
+    }
+  }
+}
+//----------------------------------------------------------------------------
+void MIPMergePickRecords(const MIPPickRecord *in, MIPIdType npixels,
+  int op, MIPPickRecord *records)
+{
+  if (op==MIP_OPERATOR_MIN) {
+    MIPMergePickRecordsT<MIPMinOperator>(in, npixels, records);
+  }
+  else {
+    MIPMergePickRecordsT<MIPMaxOperator>(in, npixels, records);
+  }
+}
+//----------------------------------------------------------------------------
+#define MIP_INSTANTIATE_WINNERS(ST) \
+  template void MIPFindWinners<float, ST>(const MIPView &, const float *, \
+    const ST *, int, const MIPIdType *, MIPIdType, const double *, MIPIdType *); \
+  template void MIPFindWinners<double, ST>(const MIPView &, const double *, \
+    const ST *, int, const MIPIdType *, MIPIdType, const double *, MIPIdType *);
+MIP_FOREACH_SCALAR_TYPE(MIP_INSTANTIATE_WINNERS)
+template void MIPMakePickRecords<float>(const MIPView &, const float *,
+  const double *, const MIPIdType *, int, MIPIdType, MIPPickRecord *);
+template void MIPMakePickRecords<double>(const MIPView &, const double *,
+  const double *, const MIPIdType *, int, MIPIdType, MIPPickRecord *);
@@ -0,0 +1,86 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPPick.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPPick - which particle won each pixel of a max (or min) image
+// .SECTION Description
+// Side buffers of the projection for picking and depth compositing : for
+// every pixel, the id, process and window depth of the particle whose value
+// the pixel holds. They are found in a second pass over the particles once
+// the image is complete, a particle wins a pixel if its value is the pixel
+// value, ties going to the lowest id. Carrying the ids through the
+// projection itself would need a 128 bit compare-and-swap per update.
+// The records of all processes are then merged like the images, ties
+// between processes going to the lowest (id, process) pair, so the result
+// does not depend on the number of threads or processes.
+//
+// .SECTION See Also
+// MIPProjection MIPOperator vtkMIPCompositor
+
+#ifndef __MIPPick_h
+#define __MIPPick_h
+
+#include "MIPProjection.h"
+
+#include <vector>
+
+//----------------------------------------------------------------------------
+// Description:
+// The winning particle of a pixel, Id is -1 for empty pixels. Depth is
+// the window z of the particle in [0,1], as in the OpenGL depth buffer.
+struct MIPPickRecord
+{
+  double    Value;
+  MIPIdType Id;
+  float     Depth;
+  int       Rank;
+};
+
+// Description:
+// The records of a whole image as kept between frames, Winners is the
+// scratch buffer of MIPFindWinners.
+struct MIPPickImage
+{
+  std::vector<MIPPickRecord> Records;
+  std::vector<MIPIdType>     Winners;
+  int                        Size[2];
+  MIPPickImage() { Size[0] = Size[1] = 0; }
+};
+
+// Description:
+// Find the winners of the pixels of image, projected and accumulated with
+// view.Operator (only max and min images have winners). The arguments
+// are those of MIPProjectPoints, index may be NULL. winners must be filled
+// with -1 beforehand; the pixels a particle wins get the lowest such
+// particle id (index[i] when an index is given, else i).
+// Instantiated for float/double points and all types of MIP_FOREACH_SCALAR_TYPE.
+template <typename PT, typename ST>
+void MIPFindWinners(const MIPView &view, const PT *points,
+  const ST *scalars, int stride, const MIPIdType *index, MIPIdType N,
+  const double *image, MIPIdType *winners);
+
+// Description:
+// Fill the records of the npixels pixels from the image and its winners,
+// computing the depth of each winning particle.
+template <typename PT>
+void MIPMakePickRecords(const MIPView &view, const PT *points,
+  const double *image, const MIPIdType *winners, int rank,
+  MIPIdType npixels, MIPPickRecord *records);
+
+// Description:
+// records[i] = the better of records[i] and in[i] for an image accumulated
+// with op, MIP_OPERATOR_MAX or MIP_OPERATOR_MIN.
+void MIPMergePickRecords(const MIPPickRecord *in, MIPIdType npixels,
+  int op, MIPPickRecord *records);
+
+#endif
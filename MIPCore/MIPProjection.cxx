@@ -0,0 +1,241 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPProjection.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPProjection.h"
+#include "MIPOperator.h"
+#include "MIPScalars.h"
+#include "MIPTransform.h"
+
+#include <algorithm>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//----------------------------------------------------------------------------
+void MIPClearImage(double *image, MIPIdType npixels, double value)
+{
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<npixels; i++) {
+    image[i] = value;
+  }
+}
+//----------------------------------------------------------------------------
+// Transform the n points of the block starting at start. When an index is
+// given the points are gathered first so the kernels see a dense block.
+template <typename PT, bool Indexed>
+inline void MIPTransformBlock(const MIPProjector &proj, const PT *points,
+  const MIPIdType *index, MIPIdType start, MIPIdType n, PT *gathered, int *ix, int *iy)
+{
+  if (Indexed) {
+    for (MIPIdType j=0; j<n; j++) {
+      const PT *p = &points[index[start+j]*3];
+      gathered[j*3+0] = p[0];
+      gathered[j*3+1] = p[1];
+      gathered[j*3+2] = p[2];
+    }
+    MIPTransformPoints(proj, gathered, n, ix, iy);
+  }
+  else {
+    MIPTransformPoints(proj, &points[start*3], n, ix, iy);
+  }
+}
+//----------------------------------------------------------------------------
+// Particles are binned by tile in batches so the bins stay a bounded size
+#define MIP_BINNING_BATCH (1<<22)
+//----------------------------------------------------------------------------
+// Two pass projection. Each thread owns a contiguous range of blocks, it
+// counts its particles per tile, the counts give every (tile, thread) pair
+// its own output range and the particles are transformed again and
+// scattered into it (the transform is cheaper than storing pixels). Then
+// tiles are reduced independently, a tile is only written by one thread.
+// Within a tile the particles keep their input order, so sums are
+// accumulated exactly as in a serial run.
+// With a band callback the tiles of the last batch are drawn one band (row
+// of tiles) at a time, the band is final once its loop completes.
+template <typename Op, typename PT, typename ST, bool Indexed>
+void MIPProjectPointsBinned(const MIPView &view, const PT *points,
+  const ST *scalars, int stride, const MIPIdType *index, MIPIdType N, double *image)
+{
+  MIPProjector proj;
+  MIPInitializeProjector(view, proj);
+  const int X = view.Size[0];
+  const int tilesX = (view.Size[0] + MIP_TILE_SIZE - 1)/MIP_TILE_SIZE;
+  const int tilesY = (view.Size[1] + MIP_TILE_SIZE - 1)/MIP_TILE_SIZE;
+  const int ntiles = tilesX*tilesY;
+  const MIPIdType batch = std::min<MIPIdType>(N, MIP_BINNING_BATCH);
+  // pixel within its tile and value of the binned particles
+  std::vector<unsigned short> offsets(batch);
+  std::vector<double> values(batch);
+  std::vector<MIPIdType> counts, tileStart(ntiles+1);
+  int nchunks = 1;
+#pragma omp parallel
+  {
+#pragma omp single
+    {
+#ifdef _OPENMP
+      nchunks = omp_get_num_threads();
+#endif
+      counts.resize(static_cast<size_t>(nchunks)*ntiles);
+    }
+    int ix[MIP_TRANSFORM_BLOCK], iy[MIP_TRANSFORM_BLOCK];
+    PT gathered[Indexed ? 3*MIP_TRANSFORM_BLOCK : 1];
+    for (MIPIdType first=0; first<N; first+=batch) {
+      const MIPIdType n = std::min(batch, N-first);
+      const MIPIdType nblocks = (n + MIP_TRANSFORM_BLOCK - 1)/MIP_TRANSFORM_BLOCK;
+      //
+      // pass 1 : count the particles of each tile
+      //
+#pragma omp for schedule(static)
+      for (int c=0; c<nchunks; c++) {
+        MIPIdType *count = &counts[static_cast<size_t>(c)*ntiles];
+        std::fill(count, count+ntiles, 0);
+        for (MIPIdType b=nblocks*c/nchunks; b<nblocks*(c+1)/nchunks; b++) {
+          MIPIdType start = first + b*MIP_TRANSFORM_BLOCK;
+          MIPIdType m = std::min<MIPIdType>(MIP_TRANSFORM_BLOCK, first+n-start);
+          MIPTransformBlock<PT, Indexed>(proj, points, index, start, m, gathered, ix, iy);
+          for (MIPIdType j=0; j<m; j++) {
+            if (ix[j]<0) continue;
+            count[(iy[j]/MIP_TILE_SIZE)*tilesX + ix[j]/MIP_TILE_SIZE]++;
+          }
+        }
+      }
+#pragma omp single
+      {
+        MIPIdType total = 0;
+        for (int t=0; t<ntiles; t++) {
+          tileStart[t] = total;
+          for (int c=0; c<nchunks; c++) {
+            MIPIdType k = counts[static_cast<size_t>(c)*ntiles + t];
+            counts[static_cast<size_t>(c)*ntiles + t] = total;
+            total += k;
+          }
+        }
+        tileStart[ntiles] = total;
+      }
+      //
+      // scatter the particles into their tile's range
+      //
+#pragma omp for schedule(static)
+      for (int c=0; c<nchunks; c++) {
+        MIPIdType *next = &counts[static_cast<size_t>(c)*ntiles];
+        for (MIPIdType b=nblocks*c/nchunks; b<nblocks*(c+1)/nchunks; b++) {
+          MIPIdType start = first + b*MIP_TRANSFORM_BLOCK;
+          MIPIdType m = std::min<MIPIdType>(MIP_TRANSFORM_BLOCK, first+n-start);
+          MIPTransformBlock<PT, Indexed>(proj, points, index, start, m, gathered, ix, iy);
+          for (MIPIdType j=0; j<m; j++) {
+            if (ix[j]<0) continue;
+            MIPIdType dst = next[(iy[j]/MIP_TILE_SIZE)*tilesX + ix[j]/MIP_TILE_SIZE]++;
+            offsets[dst] = static_cast<unsigned short>(
+              (iy[j]%MIP_TILE_SIZE)*MIP_TILE_SIZE + ix[j]%MIP_TILE_SIZE);
+            MIPIdType id = Indexed ? index[start+j] : start+j;
+            values[dst] = Op::Value(scalars ? static_cast<double>(scalars[id*stride]) : 0.0);
+          }
+        }
+      }
+      //
+      // pass 2 : reduce whole tiles, no two threads share a tile
+      //
+      const bool bands = view.BandCallback && first+n>=N;
+      for (int band=0; band<(bands ? tilesY : 1); band++) {
+        const int t0 = bands ? band*tilesX : 0;
+        const int t1 = bands ? t0+tilesX : ntiles;
+#pragma omp for schedule(dynamic,4)
+        for (int t=t0; t<t1; t++) {
+          double *tile = &image[static_cast<MIPIdType>(t/tilesX)*MIP_TILE_SIZE*X +
+                                static_cast<MIPIdType>(t%tilesX)*MIP_TILE_SIZE];
+          for (MIPIdType k=tileStart[t]; k<tileStart[t+1]; k++) {
+            Op::Accumulate(tile[(offsets[k]/MIP_TILE_SIZE)*X + offsets[k]%MIP_TILE_SIZE], values[k]);
+          }
+        }
+        if (bands) {
+          // no barrier, the other threads start on the next band
+#pragma omp master
+          view.BandCallback(band*MIP_TILE_SIZE,
+            std::min((band+1)*MIP_TILE_SIZE, view.Size[1]), view.BandData);
+        }
+      }
+    }
+  }
+}
+//----------------------------------------------------------------------------
+// Points are transformed in blocks by the (SIMD) transform kernels, then
+// scattered into the image with the atomic update of the operator (plain
+// updates when there is only one thread and no concurrent caller).
+template <typename Op, typename PT, typename ST, bool Indexed>
+void MIPProjectPointsT(const MIPView &view, const PT *points,
+  const ST *scalars, int stride, const MIPIdType *index, MIPIdType N, double *image)
+{
+  if ((view.TileBinning || view.BandCallback) && !view.Concurrent) {
+    MIPProjectPointsBinned<Op, PT, ST, Indexed>(view, points, scalars, stride, index, N, image);
+    return;
+  }
+  MIPProjector proj;
+  MIPInitializeProjector(view, proj);
+  const MIPIdType X = view.Size[0];
+  const MIPIdType nblocks = (N + MIP_TRANSFORM_BLOCK - 1)/MIP_TRANSFORM_BLOCK;
+#pragma omp parallel if(!view.Concurrent)
+  {
+    int ix[MIP_TRANSFORM_BLOCK], iy[MIP_TRANSFORM_BLOCK];
+    PT gathered[Indexed ? 3*MIP_TRANSFORM_BLOCK : 1];
+    bool shared = view.Concurrent;
+#ifdef _OPENMP
+    shared = shared || omp_get_num_threads()>1;
+#endif
+#pragma omp for schedule(static)
+    for (MIPIdType b=0; b<nblocks; b++) {
+      MIPIdType start = b*MIP_TRANSFORM_BLOCK;
+      MIPIdType n = std::min<MIPIdType>(MIP_TRANSFORM_BLOCK, N-start);
+      MIPTransformBlock<PT, Indexed>(proj, points, index, start, n, gathered, ix, iy);
+      for (MIPIdType j=0; j<n; j++) {
+        if (ix[j]<0) continue;
+        MIPIdType id = Indexed ? index[start+j] : start+j;
+        double value = Op::Value(scalars ? static_cast<double>(scalars[id*stride]) : 0.0);
+        if (shared) {
+          Op::AtomicAccumulate(&image[ix[j] + iy[j]*X], value);
+        }
+        else {
+          Op::Accumulate(image[ix[j] + iy[j]*X], value);
+        }
+      }
+    }
+  }
+}
+//----------------------------------------------------------------------------
+template <typename PT, typename ST>
+void MIPProjectPoints(const MIPView &view, const PT *points,
+  const ST *scalars, int stride, MIPIdType N, double *image)
+{
+  MIP_OPERATOR_DISPATCH(view.Operator,
+    (MIPProjectPointsT<MIPOp, PT, ST, false>(view, points, scalars, stride, NULL, N, image)));
+}
+//----------------------------------------------------------------------------
+template <typename PT, typename ST>
+void MIPProjectPoints(const MIPView &view, const PT *points,
+  const ST *scalars, int stride, const MIPIdType *index, MIPIdType N, double *image)
+{
+  MIP_OPERATOR_DISPATCH(view.Operator,
+    (MIPProjectPointsT<MIPOp, PT, ST, true>(view, points, scalars, stride, index, N, image)));
+}
+//----------------------------------------------------------------------------
+#define MIP_INSTANTIATE_PROJECT(ST) \
+  template void MIPProjectPoints<float, ST>(const MIPView &, const float *, \
+    const ST *, int, MIPIdType, double *); \
+  template void MIPProjectPoints<double, ST>(const MIPView &, const double *, \
+    const ST *, int, MIPIdType, double *); \
+  template void MIPProjectPoints<float, ST>(const MIPView &, const float *, \
+    const ST *, int, const MIPIdType *, MIPIdType, double *); \
+  template void MIPProjectPoints<double, ST>(const MIPView &, const double *, \
+    const ST *, int, const MIPIdType *, MIPIdType, double *);
+MIP_FOREACH_SCALAR_TYPE(MIP_INSTANTIATE_PROJECT)
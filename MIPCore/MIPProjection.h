@@ -0,0 +1,187 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPProjection.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPProjection - ParaView independent MIP projection kernels
+// .SECTION Description
+// The core of the MIP render : transformation of particle positions from
+// world to pixel coordinates and max accumulation of the particle scalars
+// into an image. Everything works on raw arrays so that the kernels can be
+// profiled and tuned without a ParaView session (see MIPBenchmark).
+//
+// .SECTION See Also
+// vtkMIPPainter MIPColourMap
+
+#ifndef __MIPProjection_h
+#define __MIPProjection_h
+
+#include <string.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+typedef long long MIPIdType;
+
+// Value of a pixel that no particle was projected onto.
+// This is the same as VTK_DOUBLE_MIN so the images can be reduced with MAX_OP.
+#define MIP_EMPTY_PIXEL (-1.0e+299)
+
+// Side of the square screen tiles used by the binned projection,
+// a tile of doubles (32 KB) stays in L1/L2 cache.
+#define MIP_TILE_SIZE 64
+
+//----------------------------------------------------------------------------
+// Description:
+// Called when the rows [y0, y1) of an image are final, see MIPView.
+typedef void (*MIPBandCallback)(int y0, int y1, void *data);
+
+//----------------------------------------------------------------------------
+// Description:
+// The camera/viewport information needed to project points into the image.
+struct MIPView
+{
+  MIPView() : TileBinning(false), Operator(0), BandCallback(NULL), BandData(NULL),
+    Concurrent(false) {}
+
+  // world to normalized device coordinates, row major like vtkMatrix4x4
+  double Matrix[4][4];
+  // scaling from normalized device coordinates to pixels
+  double ViewPortRatio[2];
+  // image dimensions in pixels
+  int    Size[2];
+  // project in two passes, binning the particles into screen tiles first
+  // (see MIPProjectPoints), for images much larger than the caches
+  bool   TileBinning;
+  // how the particle values are accumulated into pixels, one of the
+  // MIP_OPERATOR_* of MIPOperator.h (MIP_OPERATOR_MAX is 0)
+  int    Operator;
+  // when set, MIPProjectPoints projects via screen tiles and calls
+  // BandCallback(y0, y1, BandData) from the master thread as soon as each
+  // band of MIP_TILE_SIZE rows is final, in order, while the other threads
+  // go on drawing the next bands. Used to start compositing early.
+  MIPBandCallback BandCallback;
+  void           *BandData;
+  // set when other threads draw into the same image at the same time
+  // (e.g. small blocks of a dataset drawn one per thread) : MIPProjectPoints
+  // then runs on the calling thread alone, without tile binning or band
+  // callbacks, and updates the pixels atomically
+  bool            Concurrent;
+};
+
+//----------------------------------------------------------------------------
+inline bool MIPSignBit(double a)
+{
+  unsigned long long bits;
+  memcpy(&bits, &a, sizeof(double));
+  return (bits >> 63)!=0;
+}
+
+//----------------------------------------------------------------------------
+// Description:
+// Ordering used for the max projection. Ties between +0 and -0 are resolved
+// in favour of +0 so that the winning bit pattern never depends on the order
+// in which particles arrive. NaN never wins.
+inline bool MIPGreater(double a, double b)
+{
+  return (a>b) || (a==0.0 && b==0.0 && !MIPSignBit(a) && MIPSignBit(b));
+}
+
+//----------------------------------------------------------------------------
+// Description:
+// Lock-free max update of a pixel shared between threads. The pixel is read
+// first and a compare-and-swap is only attempted when the new value wins, so
+// once the image has filled up most particles do no atomic write at all.
+// Max is order independent, so the result is identical to a serial run.
+inline void MIPAtomicMax(double *pixel, double value)
+{
+#if defined(_MSC_VER)
+  volatile __int64 *ipixel = reinterpret_cast<volatile __int64 *>(pixel);
+  __int64 current = *ipixel;
+#else
+  unsigned long long *ipixel = reinterpret_cast<unsigned long long *>(pixel);
+  unsigned long long current = __atomic_load_n(ipixel, __ATOMIC_RELAXED);
+#endif
+  for (;;) {
+    double cvalue;
+    memcpy(&cvalue, &current, sizeof(double));
+    if (!MIPGreater(value, cvalue)) {
+      return;
+    }
+#if defined(_MSC_VER)
+    __int64 desired;
+    memcpy(&desired, &value, sizeof(double));
+    __int64 previous = _InterlockedCompareExchange64(ipixel, desired, current);
+    if (previous==current) {
+      return;
+    }
+    current = previous;
+#else
+    unsigned long long desired;
+    memcpy(&desired, &value, sizeof(double));
+    // on failure current is updated with the value now stored in the pixel
+    if (__atomic_compare_exchange_n(ipixel, &current, desired, true,
+      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      return;
+    }
+#endif
+  }
+}
+
+//----------------------------------------------------------------------------
+// Description:
+// Read a pixel that other threads may be updating with MIPAtomicMax.
+inline double MIPLoadPixel(const double *pixel)
+{
+#if defined(_MSC_VER)
+  __int64 bits = *reinterpret_cast<const volatile __int64 *>(pixel);
+#else
+  unsigned long long bits = __atomic_load_n(
+    reinterpret_cast<const unsigned long long *>(pixel), __ATOMIC_RELAXED);
+#endif
+  double value;
+  memcpy(&value, &bits, sizeof(double));
+  return value;
+}
+
+//----------------------------------------------------------------------------
+// Description:
+// Fill an image with a value, MIP_EMPTY_PIXEL by default.
+void MIPClearImage(double *image, MIPIdType npixels, double value=MIP_EMPTY_PIXEL);
+
+// Description:
+// Project N points (xyz interleaved) into the image and accumulate the
+// scalars per pixel with view.Operator (the max for the default
+// MIP_OPERATOR_MAX, the image must then be cleared with the
+// MIPOperatorEmpty value). The value of particle i is scalars[i*stride], so
+// one component of an interleaved array can be used in place. If scalars
+// is NULL every particle has the value 0. The image must have
+// view.Size[0]*view.Size[1] pixels and is not cleared.
+// With view.TileBinning the projected particles are first sorted into
+// MIP_TILE_SIZE square tiles (a parallel counting sort), then every thread
+// reduces whole tiles, so all writes stay in cache and need no atomics.
+// The image is identical either way, except for the rounding of sums
+// accumulated by several threads without binning.
+// A view.BandCallback implies tile binning, it is only called when the
+// call draws at least one particle.
+// Instantiated for float/double points and all types of MIP_FOREACH_SCALAR_TYPE.
+template <typename PT, typename ST>
+void MIPProjectPoints(const MIPView &view, const PT *points,
+  const ST *scalars, int stride, MIPIdType N, double *image);
+
+// Description:
+// As above, but only the N particles index[0..N-1] are projected.
+template <typename PT, typename ST>
+void MIPProjectPoints(const MIPView &view, const PT *points,
+  const ST *scalars, int stride, const MIPIdType *index, MIPIdType N, double *image);
+
+#endif
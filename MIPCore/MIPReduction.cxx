@@ -0,0 +1,100 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPReduction.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPReduction.h"
+
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+#define MIP_QUANTIZE_LEVELS 65534.0
+
+//----------------------------------------------------------------------------
+void MIPImageRange(const double *image, MIPIdType npixels, double range[2])
+{
+  double lo = std::numeric_limits<double>::max();
+  double hi = -std::numeric_limits<double>::max();
+#pragma omp parallel
+  {
+    double tlo = lo, thi = hi;
+#pragma omp for schedule(static) nowait
+    for (MIPIdType i=0; i<npixels; i++) {
+      double v = image[i];
+      if (v==MIP_EMPTY_PIXEL) continue;
+      tlo = (v<tlo) ? v : tlo;
+      thi = (v>thi) ? v : thi;
+    }
+#pragma omp critical
+    {
+      lo = (tlo<lo) ? tlo : lo;
+      hi = (thi>hi) ? thi : hi;
+    }
+  }
+  range[0] = lo;
+  range[1] = hi;
+}
+//----------------------------------------------------------------------------
+void MIPEncodeFloat(const double *image, MIPIdType npixels, float *out)
+{
+  const float empty = -std::numeric_limits<float>::infinity();
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<npixels; i++) {
+    double v = image[i];
+    out[i] = (v==MIP_EMPTY_PIXEL)  ? empty :
+             (v==-MIP_EMPTY_PIXEL) ? -empty :
+      ((v < -FLT_MAX) ? -FLT_MAX : (v > FLT_MAX) ? FLT_MAX : static_cast<float>(v));
+  }
+}
+//----------------------------------------------------------------------------
+void MIPDecodeFloat(const float *in, MIPIdType npixels, double *image)
+{
+  const float empty = -std::numeric_limits<float>::infinity();
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<npixels; i++) {
+    float v = in[i];
+    image[i] = (v==empty)  ? MIP_EMPTY_PIXEL :
+               (v==-empty) ? -MIP_EMPTY_PIXEL : static_cast<double>(v);
+  }
+}
+//----------------------------------------------------------------------------
+void MIPQuantize16(const double *image, MIPIdType npixels,
+  const double range[2], unsigned short *out)
+{
+  const double lo = range[0];
+  const double scale = (range[1]>range[0]) ? MIP_QUANTIZE_LEVELS/(range[1]-range[0]) : 0.0;
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<npixels; i++) {
+    double v = image[i];
+    if (v==MIP_EMPTY_PIXEL) {
+      out[i] = 0;
+      continue;
+    }
+    double q = floor((v-lo)*scale);
+    q = (q<0.0) ? 0.0 : ((q>MIP_QUANTIZE_LEVELS) ? MIP_QUANTIZE_LEVELS : q);
+    out[i] = static_cast<unsigned short>(q + 1.0);
+  }
+}
+//----------------------------------------------------------------------------
+void MIPDequantize16(const unsigned short *in, MIPIdType npixels,
+  const double range[2], double *image)
+{
+  const double lo = range[0];
+  const double step = (range[1]-range[0])/MIP_QUANTIZE_LEVELS;
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<npixels; i++) {
+    unsigned short q = in[i];
+    image[i] = (q==0) ? MIP_EMPTY_PIXEL :
+      ((q==65535) ? range[1] : lo + (q-1)*step);
+  }
+}
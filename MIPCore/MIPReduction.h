@@ -0,0 +1,52 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPReduction.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPReduction - compact encodings of a MIP image for compositing
+// .SECTION Description
+// Images are reduced across processes with a max operator. Any monotone
+// (order preserving) encoding commutes with max, so the reduction can be
+// done on a smaller encoding and decoded afterwards :
+//   float  : 4 bytes/pixel, empty pixels are -inf (+inf for the empty
+//            pixels of min images), also usable with the other operators
+//   uint16 : 2 bytes/pixel, values quantized over a range that all processes
+//            agree on beforehand, 0 marks empty pixels
+//
+// .SECTION See Also
+// vtkMIPCompositor
+
+#ifndef __MIPReduction_h
+#define __MIPReduction_h
+
+#include "MIPProjection.h"
+
+// Description:
+// Min/max of the non empty pixels, range[0]>range[1] if there are none.
+void MIPImageRange(const double *image, MIPIdType npixels, double range[2]);
+
+// Description:
+// Float encoding. MIP_EMPTY_PIXEL and -MIP_EMPTY_PIXEL (the empty value of
+// min images, see MIPOperator) are sent as -inf and +inf, other values are
+// clamped to [-FLT_MAX, FLT_MAX] so they remain distinct from them.
+void MIPEncodeFloat(const double *image, MIPIdType npixels, float *out);
+void MIPDecodeFloat(const float *in, MIPIdType npixels, double *image);
+
+// Description:
+// 16 bit encoding over range. range[0] and range[1] decode exactly, the
+// values in between to within (range[1]-range[0])/65534.
+void MIPQuantize16(const double *image, MIPIdType npixels,
+  const double range[2], unsigned short *out);
+void MIPDequantize16(const unsigned short *in, MIPIdType npixels,
+  const double range[2], double *image);
+
+#endif
@@ -0,0 +1,99 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPScalars.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPScalars.h"
+
+#include <cmath>
+
+//----------------------------------------------------------------------------
+// The component count is a template parameter for the common vector/tensor
+// sizes so the inner loop is fully unrolled and the outer loop vectorizes.
+template <typename T, int C>
+static void MIPMagnitudeAOS(const T *data, MIPIdType N, double *out)
+{
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<N; i++) {
+    const T *t = &data[i*C];
+    double sum = 0.0;
+    for (int c=0; c<C; c++) {
+      double v = static_cast<double>(t[c]);
+      sum += v*v;
+    }
+    out[i] = sqrt(sum);
+  }
+}
+//----------------------------------------------------------------------------
+template <typename T>
+void MIPComputeMagnitude(const T *data, int C, MIPIdType N, double *out)
+{
+  switch (C) {
+    case 2: MIPMagnitudeAOS<T, 2>(data, N, out); return;
+    case 3: MIPMagnitudeAOS<T, 3>(data, N, out); return;
+    case 4: MIPMagnitudeAOS<T, 4>(data, N, out); return;
+    case 6: MIPMagnitudeAOS<T, 6>(data, N, out); return;
+    case 9: MIPMagnitudeAOS<T, 9>(data, N, out); return;
+  }
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<N; i++) {
+    const T *t = &data[i*C];
+    double sum = 0.0;
+    for (int c=0; c<C; c++) {
+      double v = static_cast<double>(t[c]);
+      sum += v*v;
+    }
+    out[i] = sqrt(sum);
+  }
+}
+//----------------------------------------------------------------------------
+// Component arrays are contiguous, accumulate one component at a time over
+// a block of tuples so every pass is a unit stride, vectorizable loop.
+template <typename T>
+void MIPComputeMagnitude(const T * const *components, int C, MIPIdType N, double *out)
+{
+  const MIPIdType block = 1024;
+  const MIPIdType nblocks = (N + block - 1)/block;
+#pragma omp parallel for schedule(static)
+  for (MIPIdType b=0; b<nblocks; b++) {
+    MIPIdType start = b*block;
+    MIPIdType end = (start+block<N) ? start+block : N;
+    for (MIPIdType i=start; i<end; i++) {
+      out[i] = 0.0;
+    }
+    for (int c=0; c<C; c++) {
+      const T *comp = components[c];
+      for (MIPIdType i=start; i<end; i++) {
+        double v = static_cast<double>(comp[i]);
+        out[i] += v*v;
+      }
+    }
+    for (MIPIdType i=start; i<end; i++) {
+      out[i] = sqrt(out[i]);
+    }
+  }
+}
+//----------------------------------------------------------------------------
+template <typename T>
+void MIPMultiplyValues(const T *data, int stride, MIPIdType N, double *out)
+{
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<N; i++) {
+    out[i] *= static_cast<double>(data[i*stride]);
+  }
+}
+//----------------------------------------------------------------------------
+#define MIP_INSTANTIATE_MAGNITUDE(T) \
+  template void MIPComputeMagnitude<T>(const T *, int, MIPIdType, double *); \
+  template void MIPComputeMagnitude<T>(const T * const *, int, MIPIdType, double *); \
+  template void MIPMultiplyValues<T>(const T *, int, MIPIdType, double *);
+MIP_FOREACH_SCALAR_TYPE(MIP_INSTANTIATE_MAGNITUDE)
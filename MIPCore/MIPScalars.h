@@ -0,0 +1,64 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPScalars.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPScalars - typed access to the particle scalars
+// .SECTION Description
+// The projection kernels read scalars directly from the data array memory
+// in its native type. This file lists the supported types and provides
+// the magnitude kernels used for multi-component arrays, both for
+// interleaved (AOS) and one-array-per-component (SOA) layouts, and the
+// products used for weighted means.
+//
+// .SECTION See Also
+// MIPProjection
+
+#ifndef __MIPScalars_h
+#define __MIPScalars_h
+
+#include "MIPProjection.h"
+
+// Description:
+// Call macro M(T) for every scalar type the kernels are instantiated for,
+// this covers all the VTK numeric types.
+#define MIP_FOREACH_SCALAR_TYPE(M) \
+  M(char)                          \
+  M(signed char)                   \
+  M(unsigned char)                 \
+  M(short)                         \
+  M(unsigned short)                \
+  M(int)                           \
+  M(unsigned int)                  \
+  M(long)                          \
+  M(unsigned long)                 \
+  M(long long)                     \
+  M(unsigned long long)            \
+  M(float)                         \
+  M(double)
+
+// Description:
+// out[i] = |tuple i| for N tuples of C interleaved components.
+template <typename T>
+void MIPComputeMagnitude(const T *data, int C, MIPIdType N, double *out);
+
+// Description:
+// out[i] = |tuple i| for N tuples stored as C separate component arrays.
+template <typename T>
+void MIPComputeMagnitude(const T * const *components, int C, MIPIdType N, double *out);
+
+// Description:
+// out[i] *= data[i*stride] for N values, used to weight the scalars.
+template <typename T>
+void MIPMultiplyValues(const T *data, int stride, MIPIdType N, double *out);
+
+#endif
@@ -0,0 +1,244 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPScaling.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPScaling - scaling benchmark over synthetic particle clouds
+// .SECTION Description
+// Runs the frame of vtkMIPPainter (projection, max reduction to process 0,
+// colour mapping) over the deterministic clouds of MIPSynthetic, sweeping
+// the particle count, distribution, image size and thread count. Each
+// process generates and projects its own slice of the cloud, so the same
+// run under mpirun measures the rank scaling (see MIPScaling.sh).
+// One CSV line is written per configuration, with the phase times of the
+// slowest process averaged over the frames, so runs can be compared
+// between builds to catch throughput regressions.
+//
+// Usage : MIPScaling [--particles 1e6,1e7] [--distributions uniform,plummer,halos]
+//                    [--images 512x512,1920x1080,3840x2160] [--threads 1,2,4]
+//                    [--frames 5] [--seed 1] [--output results.csv] [--no-header]
+// Threads default to powers of two up to the OpenMP maximum. 10^8 and 10^9
+// particles take 1.6 and 16 GB in total, spread over the processes.
+
+#include "MIPProjection.h"
+#include "MIPColourMap.h"
+#include "MIPSparse.h"
+#include "MIPSynthetic.h"
+#include "MIPTransform.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef MIP_SCALING_MPI
+#include <mpi.h>
+#endif
+
+//----------------------------------------------------------------------------
+static double MIPScalingSeconds()
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+//----------------------------------------------------------------------------
+static std::vector<std::string> MIPScalingSplit(const char *list)
+{
+  std::vector<std::string> items;
+  std::string s(list);
+  size_t start = 0;
+  while (start<=s.size()) {
+    size_t end = s.find(',', start);
+    if (end==std::string::npos) end = s.size();
+    if (end>start) items.push_back(s.substr(start, end-start));
+    start = end+1;
+  }
+  return items;
+}
+//----------------------------------------------------------------------------
+// The max over processes of the local values, on process 0
+static void MIPScalingReduceMax(double *values, int n)
+{
+#ifdef MIP_SCALING_MPI
+  std::vector<double> local(values, values+n);
+  MPI_Reduce(&local[0], values, n, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+#else
+  (void)values;
+  (void)n;
+#endif
+}
+//----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  int rank = 0, P = 1;
+#ifdef MIP_SCALING_MPI
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &P);
+#endif
+  int maxThreads = 1;
+#ifdef _OPENMP
+  maxThreads = omp_get_max_threads();
+#endif
+  //
+  // the sweep
+  //
+  std::vector<std::string> particles, distributions, images, threadList;
+  particles.push_back("1e6");
+  particles.push_back("1e7");
+  distributions.push_back("uniform");
+  distributions.push_back("plummer");
+  distributions.push_back("halos");
+  images.push_back("512x512");
+  images.push_back("1920x1080");
+  images.push_back("3840x2160");
+  for (int t=1; ; t = std::min(t*2, maxThreads)) {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%d", t);
+    threadList.push_back(buffer);
+    if (t==maxThreads) break;
+  }
+  int frames = 5;
+  unsigned long long seed = 1;
+  const char *output = NULL;
+  bool header = true;
+  for (int a=1; a<argc; a++) {
+    std::string arg(argv[a]);
+    const char *value = (a+1<argc) ? argv[a+1] : "";
+    if      (arg=="--particles")     { particles     = MIPScalingSplit(value); a++; }
+    else if (arg=="--distributions") { distributions = MIPScalingSplit(value); a++; }
+    else if (arg=="--images")        { images        = MIPScalingSplit(value); a++; }
+    else if (arg=="--threads")       { threadList    = MIPScalingSplit(value); a++; }
+    else if (arg=="--frames")        { frames = std::max(atoi(value), 1); a++; }
+    else if (arg=="--seed")          { seed = strtoull(value, NULL, 10); a++; }
+    else if (arg=="--output")        { output = value; a++; }
+    else if (arg=="--no-header")     { header = false; }
+    else {
+      if (rank==0) {
+        fprintf(stderr, "MIPScaling : unknown argument %s\n", argv[a]);
+      }
+#ifdef MIP_SCALING_MPI
+      MPI_Finalize();
+#endif
+      return 1;
+    }
+  }
+  FILE *out = stdout;
+  if (rank==0 && output) {
+    out = fopen(output, "a");
+    if (!out) {
+      fprintf(stderr, "MIPScaling : cannot open %s\n", output);
+      out = stdout;
+    }
+  }
+  if (rank==0 && header) {
+    fprintf(out, "distribution,particles,ranks,threads,width,height,frames,"
+      "project_ms,reduce_ms,colour_ms,frame_ms,mparticles_per_s,"
+      "occupied_pixels,transform\n");
+  }
+  MIPColourTable table;
+  MIPSyntheticGreyTable(table);
+  const unsigned char background[4] = {0, 0, 0, 255};
+
+  for (size_t pi=0; pi<particles.size(); pi++) {
+    MIPIdType total = static_cast<MIPIdType>(strtod(particles[pi].c_str(), NULL));
+    MIPIdType first = total*rank/P;
+    MIPIdType N     = total*(rank+1)/P - first;
+    std::vector<float> points(std::max<MIPIdType>(N*3, 3)), scalars(std::max<MIPIdType>(N, 1));
+    for (size_t di=0; di<distributions.size(); di++) {
+      int distribution = MIPSyntheticFromName(distributions[di].c_str());
+      if (distribution<0) {
+        if (rank==0) {
+          fprintf(stderr, "MIPScaling : unknown distribution %s\n", distributions[di].c_str());
+        }
+        continue;
+      }
+      MIPSyntheticSetThreads(maxThreads);
+      MIPGenerateParticles(distribution, seed, first, N, &points[0], &scalars[0]);
+      for (size_t ii=0; ii<images.size(); ii++) {
+        int X = 0, Y = 0;
+        if (sscanf(images[ii].c_str(), "%dx%d", &X, &Y)!=2 || X<1 || Y<1) {
+          if (rank==0) {
+            fprintf(stderr, "MIPScaling : bad image size %s\n", images[ii].c_str());
+          }
+          continue;
+        }
+        MIPView view;
+        MIPSyntheticView(X, Y, view);
+        const MIPIdType npixels = static_cast<MIPIdType>(X)*Y;
+        std::vector<double> image(npixels), result(rank==0 ? npixels : 1);
+        std::vector<unsigned char> rgb(rank==0 ? npixels*3 : 1);
+        for (size_t ti=0; ti<threadList.size(); ti++) {
+          int threads = std::max(atoi(threadList[ti].c_str()), 1);
+          MIPSyntheticSetThreads(threads);
+          // one untimed frame first, so the buffers are touched by these threads
+          double times[3] = {0.0, 0.0, 0.0};
+          double occupied = 0.0;
+          for (int f=-1; f<frames; f++) {
+#ifdef MIP_SCALING_MPI
+            MPI_Barrier(MPI_COMM_WORLD);
+#endif
+            double t0 = MIPScalingSeconds();
+            MIPClearImage(&image[0], npixels);
+            MIPProjectPoints(view, &points[0], &scalars[0], 1, N, &image[0]);
+            double t1 = MIPScalingSeconds();
+#ifdef MIP_SCALING_MPI
+            MPI_Reduce(&image[0], &result[0], static_cast<int>(npixels), MPI_DOUBLE,
+              MPI_MAX, 0, MPI_COMM_WORLD);
+#else
+            memcpy(&result[0], &image[0], npixels*sizeof(double));
+#endif
+            double t2 = MIPScalingSeconds();
+            if (rank==0) {
+              MIPColourMapImage(&result[0], npixels, table, background, 3, &rgb[0]);
+            }
+            double t3 = MIPScalingSeconds();
+            double frame[3] = { t1-t0, t2-t1, t3-t2 };
+            MIPScalingReduceMax(frame, 3);
+            if (f>=0) {
+              times[0] += frame[0];
+              times[1] += frame[1];
+              times[2] += frame[2];
+            }
+            if (f==0 && rank==0) {
+              occupied = static_cast<double>(MIPCountOccupied(&result[0], npixels));
+            }
+          }
+          if (rank==0) {
+            double project = times[0]/frames, reduce = times[1]/frames;
+            double colour = times[2]/frames;
+            double frame = project + reduce + colour;
+            fprintf(out, "%s,%lld,%d,%d,%d,%d,%d,%.4f,%.4f,%.4f,%.4f,%.3f,%.0f,%s\n",
+              MIPSyntheticName(distribution), static_cast<long long>(total), P, threads,
+              X, Y, frames, project*1000.0, reduce*1000.0, colour*1000.0, frame*1000.0,
+              (project>0.0) ? total/project/1.0e6 : 0.0, occupied,
+              MIPTransformInstructionSet());
+            fflush(out);
+          }
+        }
+      }
+    }
+  }
+  if (out!=stdout) {
+    fclose(out);
+  }
+#ifdef MIP_SCALING_MPI
+  MPI_Finalize();
+#endif
+  return 0;
+}
@@ -0,0 +1,23 @@
+#!/bin/sh
+#--------------------------------------------------
+# Rank sweep of the MIPScaling benchmark : runs it
+# under mpirun for each process count and collects
+# all configurations in one CSV file.
+#
+# Usage : [RANKS="1 2 4"] MIPScaling.sh <MIPScaling> <results.csv> [MIPScaling arguments]
+# e.g.  : RANKS="1 2 4 8" MIPScaling.sh ./MIPScaling scaling.csv --particles 1e8 --threads 1,4
+# The process counts are taken from RANKS, mpirun
+# from MPIRUN.
+#--------------------------------------------------
+set -e
+BENCHMARK=${1:?path to MIPScaling}
+RESULTS=${2:?output csv file}
+shift 2
+RANKS=${RANKS:-"1 2 4"}
+MPIRUN=${MPIRUN:-mpirun}
+
+HEADER=""
+for P in $RANKS; do
+  "$MPIRUN" -np "$P" "$BENCHMARK" --output "$RESULTS" $HEADER "$@"
+  HEADER="--no-header"
+done
@@ -0,0 +1,227 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPSparse.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPSparse.h"
+
+#include <algorithm>
+
+enum { MIP_SPARSE_BITMASK = 0, MIP_SPARSE_DENSE = 1 };
+
+//----------------------------------------------------------------------------
+// Header at the start of every encoded image, followed by the (8 byte
+// aligned) bitmask and the values.
+struct MIPSparseHeader
+{
+  MIPRect   Rect;
+  int       Format;
+  int       Padding;
+  MIPIdType Count;
+};
+
+//----------------------------------------------------------------------------
+static inline size_t MIPAlign8(size_t n)
+{
+  return (n + 7) & ~static_cast<size_t>(7);
+}
+//----------------------------------------------------------------------------
+void MIPImageBounds(const double *image, int X, int Y, MIPRect &rect, double empty)
+{
+  int x0 = X, y0 = Y, x1 = 0, y1 = 0;
+#pragma omp parallel
+  {
+    int tx0 = X, ty0 = Y, tx1 = 0, ty1 = 0;
+#pragma omp for schedule(static) nowait
+    for (int y=0; y<Y; y++) {
+      const double *row = &image[static_cast<MIPIdType>(y)*X];
+      int first = -1, last = -1;
+      for (int x=0; x<X; x++) {
+        if (row[x]!=empty) {
+          if (first<0) first = x;
+          last = x;
+        }
+      }
+      if (first<0) continue;
+      tx0 = std::min(tx0, first);
+      tx1 = std::max(tx1, last+1);
+      ty0 = std::min(ty0, y);
+      ty1 = std::max(ty1, y+1);
+    }
+#pragma omp critical
+    {
+      x0 = std::min(x0, tx0);
+      y0 = std::min(y0, ty0);
+      x1 = std::max(x1, tx1);
+      y1 = std::max(y1, ty1);
+    }
+  }
+  rect.X0 = x0;
+  rect.Y0 = y0;
+  rect.X1 = x1;
+  rect.Y1 = y1;
+}
+//----------------------------------------------------------------------------
+MIPIdType MIPCountOccupied(const double *image, MIPIdType npixels, double empty)
+{
+  MIPIdType count = 0;
+#pragma omp parallel for schedule(static) reduction(+:count)
+  for (MIPIdType i=0; i<npixels; i++) {
+    count += (image[i]!=empty) ? 1 : 0;
+  }
+  return count;
+}
+//----------------------------------------------------------------------------
+void MIPRectUnion(const MIPRect &a, const MIPRect &b, MIPRect &result)
+{
+  bool aempty = (a.X0>=a.X1 || a.Y0>=a.Y1);
+  bool bempty = (b.X0>=b.X1 || b.Y0>=b.Y1);
+  if (aempty) {
+    result = b;
+    return;
+  }
+  if (bempty) {
+    result = a;
+    return;
+  }
+  result.X0 = std::min(a.X0, b.X0);
+  result.Y0 = std::min(a.Y0, b.Y0);
+  result.X1 = std::max(a.X1, b.X1);
+  result.Y1 = std::max(a.Y1, b.Y1);
+}
+//----------------------------------------------------------------------------
+void MIPEncodeSparse(const double *image, int X, const MIPRect &rect,
+  std::vector<char> &buffer, double empty)
+{
+  MIPSparseHeader header;
+  header.Rect    = rect;
+  header.Padding = 0;
+  const int w = std::max(0, rect.X1-rect.X0);
+  const int h = std::max(0, rect.Y1-rect.Y0);
+  const size_t rowbytes = (w+7)/8;
+  //
+  // count the occupied pixels of each row, rows are encoded independently
+  //
+  std::vector<MIPIdType> offsets(h+1, 0);
+#pragma omp parallel for schedule(static)
+  for (int j=0; j<h; j++) {
+    const double *row = &image[static_cast<MIPIdType>(rect.Y0+j)*X + rect.X0];
+    MIPIdType count = 0;
+    for (int i=0; i<w; i++) {
+      count += (row[i]!=empty);
+    }
+    offsets[j+1] = count;
+  }
+  for (int j=0; j<h; j++) {
+    offsets[j+1] += offsets[j];
+  }
+  header.Count = offsets[h];
+  const size_t maskbytes   = MIPAlign8(rowbytes*h);
+  const size_t sparsebytes = maskbytes + header.Count*sizeof(double);
+  const size_t densebytes  = static_cast<size_t>(w)*h*sizeof(double);
+  header.Format = (sparsebytes<densebytes) ? MIP_SPARSE_BITMASK : MIP_SPARSE_DENSE;
+  //
+  // fill in
+  //
+  const size_t headerbytes = MIPAlign8(sizeof(MIPSparseHeader));
+  if (header.Format==MIP_SPARSE_DENSE) {
+    buffer.resize(headerbytes + densebytes);
+    memcpy(&buffer[0], &header, sizeof(header));
+    char *values = &buffer[headerbytes];
+#pragma omp parallel for schedule(static)
+    for (int j=0; j<h; j++) {
+      memcpy(values + static_cast<size_t>(j)*w*sizeof(double),
+        &image[static_cast<MIPIdType>(rect.Y0+j)*X + rect.X0], w*sizeof(double));
+    }
+    return;
+  }
+  buffer.assign(headerbytes + sparsebytes, 0);
+  memcpy(&buffer[0], &header, sizeof(header));
+  unsigned char *mask = reinterpret_cast<unsigned char*>(&buffer[headerbytes]);
+  char *values = &buffer[headerbytes + maskbytes];
+#pragma omp parallel for schedule(static)
+  for (int j=0; j<h; j++) {
+    const double *row = &image[static_cast<MIPIdType>(rect.Y0+j)*X + rect.X0];
+    unsigned char *rowmask = &mask[rowbytes*j];
+    char *out = values + offsets[j]*sizeof(double);
+    for (int i=0; i<w; i++) {
+      if (row[i]==empty) continue;
+      rowmask[i>>3] |= static_cast<unsigned char>(1 << (i&7));
+      memcpy(out, &row[i], sizeof(double));
+      out += sizeof(double);
+    }
+  }
+}
+//----------------------------------------------------------------------------
+template <typename Op>
+static void MIPMergeSparseT(const char *buffer, double *image, int X, MIPRect &rect)
+{
+  MIPSparseHeader header;
+  memcpy(&header, buffer, sizeof(header));
+  rect = header.Rect;
+  const int w = std::max(0, rect.X1-rect.X0);
+  const int h = std::max(0, rect.Y1-rect.Y0);
+  const char *data = buffer + MIPAlign8(sizeof(MIPSparseHeader));
+  if (header.Format==MIP_SPARSE_DENSE) {
+#pragma omp parallel for schedule(static)
+    for (int j=0; j<h; j++) {
+      double *row = &image[static_cast<MIPIdType>(rect.Y0+j)*X + rect.X0];
+      const char *in = data + static_cast<size_t>(j)*w*sizeof(double);
+      for (int i=0; i<w; i++) {
+        double v;
+        memcpy(&v, in + i*sizeof(double), sizeof(double));
+        Op::Accumulate(row[i], v);
+      }
+    }
+    return;
+  }
+  //
+  // the values of each row start after the occupied pixels of all previous rows
+  //
+  const size_t rowbytes = (w+7)/8;
+  const unsigned char *mask = reinterpret_cast<const unsigned char*>(data);
+  const char *values = data + MIPAlign8(rowbytes*h);
+  std::vector<MIPIdType> offsets(h+1, 0);
+#pragma omp parallel for schedule(static)
+  for (int j=0; j<h; j++) {
+    MIPIdType count = 0;
+    for (size_t b=0; b<rowbytes; b++) {
+      unsigned char m = mask[rowbytes*j + b];
+      while (m) {
+        count += (m & 1);
+        m >>= 1;
+      }
+    }
+    offsets[j+1] = count;
+  }
+  for (int j=0; j<h; j++) {
+    offsets[j+1] += offsets[j];
+  }
+#pragma omp parallel for schedule(static)
+  for (int j=0; j<h; j++) {
+    double *row = &image[static_cast<MIPIdType>(rect.Y0+j)*X + rect.X0];
+    const unsigned char *rowmask = &mask[rowbytes*j];
+    const char *in = values + offsets[j]*sizeof(double);
+    for (int i=0; i<w; i++) {
+      if (!(rowmask[i>>3] & (1 << (i&7)))) continue;
+      double v;
+      memcpy(&v, in, sizeof(double));
+      in += sizeof(double);
+      Op::Accumulate(row[i], v);
+    }
+  }
+}
+//----------------------------------------------------------------------------
+void MIPMergeSparse(const char *buffer, double *image, int X, MIPRect &rect, int op)
+{
+  MIP_OPERATOR_DISPATCH(op, MIPMergeSparseT<MIPOp>(buffer, image, X, rect));
+}
@@ -0,0 +1,71 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPSparse.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPSparse - occupancy compressed encoding of MIP images
+// .SECTION Description
+// A process usually only covers part of the screen with its piece of the
+// particles. A sparse image is the bounding rectangle of the non empty
+// pixels followed either by
+//   a bitmask of occupied pixels (rows padded to whole bytes) and the
+//   values of the occupied pixels only, or
+//   all the values of the rectangle when that is smaller (high occupancy).
+// The smaller of the two is chosen automatically, so the message size
+// scales with the projected footprint instead of the window size.
+// Images accumulated with other operators than the max are encoded with
+// the empty value of their operator (see MIPOperator).
+//
+// .SECTION See Also
+// vtkMIPCompositor MIPReduction
+
+#ifndef __MIPSparse_h
+#define __MIPSparse_h
+
+#include "MIPOperator.h"
+
+#include <vector>
+
+//----------------------------------------------------------------------------
+// Description:
+// Pixel rectangle [X0,X1) x [Y0,Y1), empty if X0>=X1 or Y0>=Y1.
+struct MIPRect
+{
+  int X0, Y0, X1, Y1;
+};
+
+// Description:
+// Bounding rectangle of the pixels of an X*Y image that are not empty.
+void MIPImageBounds(const double *image, int X, int Y, MIPRect &rect,
+  double empty=MIP_EMPTY_PIXEL);
+
+// Description:
+// Number of pixels of an image that are not empty.
+MIPIdType MIPCountOccupied(const double *image, MIPIdType npixels,
+  double empty=MIP_EMPTY_PIXEL);
+
+// Description:
+// Union of two rectangles (empty ones are ignored).
+void MIPRectUnion(const MIPRect &a, const MIPRect &b, MIPRect &result);
+
+// Description:
+// Encode the pixels of image (row length X) inside rect into buffer.
+void MIPEncodeSparse(const double *image, int X, const MIPRect &rect,
+  std::vector<char> &buffer, double empty=MIP_EMPTY_PIXEL);
+
+// Description:
+// Merge an encoded image into image (row length X) with the operator op.
+// The rectangle it covered is returned in rect.
+void MIPMergeSparse(const char *buffer, double *image, int X, MIPRect &rect,
+  int op=MIP_OPERATOR_MAX);
+
+#endif
@@ -0,0 +1,361 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPSplat.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPSplat.h"
+#include "MIPOperator.h"
+#include "MIPScalars.h"
+#include "MIPTransform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Particles are binned by tile in batches so the bins stay a bounded size
+#define MIP_SPLAT_BATCH (1<<18)
+
+//----------------------------------------------------------------------------
+// Kernels as a function of q^2 = dx^2 + dy^2, normalized to 1 at the centre,
+// 0 <= q <= 1. Separable kernels are the product of Factor(dx^2) and
+// Factor(dy^2), so the weight of a pixel costs one multiplication.
+struct MIPKernelTopHat
+{
+  enum { Separable = 1 };
+  static double Factor(double) { return 1.0; }
+  static double Weight(double) { return 1.0; }
+};
+struct MIPKernelCubicSpline
+{
+  enum { Separable = 0 };
+  static double Factor(double) { return 1.0; }
+  static double Weight(double q2)
+  {
+    double q = sqrt(q2);
+    if (q<0.5) {
+      return 1.0 - 6.0*q2 + 6.0*q2*q;
+    }
+    double t = 1.0 - q;
+    return 2.0*t*t*t;
+  }
+};
+struct MIPKernelGaussian
+{
+  enum { Separable = 1 };
+  static double Factor(double d2) { return exp(-4.5*d2); }
+  static double Weight(double q2) { return exp(-4.5*q2); }
+};
+
+//----------------------------------------------------------------------------
+// The footprint of one particle
+struct MIPSplatRecord
+{
+  // centre, in pixels (pixel i is centred on i)
+  double X, Y;
+  // inverse of the footprint radii, in pixels
+  double SX, SY;
+  double Value;
+  // covered pixels x0, x1, y0, y1 (inclusive) clipped to the image,
+  // Box[0] is -1 if the particle is not drawn
+  int    Box[4];
+  // row width the footprint is drawn with, 0 for a single pixel,
+  // else 4, 8, 16 or MIP_TILE_SIZE (any width, as tiles clip it)
+  int    Width;
+};
+
+//----------------------------------------------------------------------------
+// Pixels per world unit of a sphere at w=1 (perspective) or anywhere
+// (orthographic), along x and y : the length of the projector rows with
+// the component along the view direction (Row[2]) removed.
+static void MIPSplatScales(const MIPProjector &P, double scale[2])
+{
+  const double *w = P.Row[2];
+  const double ww = w[0]*w[0] + w[1]*w[1] + w[2]*w[2];
+  for (int j=0; j<2; j++) {
+    const double *r = P.Row[j];
+    const double d = (ww>0.0) ? (r[0]*w[0] + r[1]*w[1] + r[2]*w[2])/ww : 0.0;
+    double s = 0.0;
+    for (int k=0; k<3; k++) {
+      s += (r[k] - d*w[k])*(r[k] - d*w[k]);
+    }
+    scale[j] = sqrt(s);
+  }
+}
+//----------------------------------------------------------------------------
+// Project one particle, the centre is computed exactly as MIPTransformPoints
+// does so that footprints under a pixel land on the same pixel.
+template <typename PT>
+static inline bool MIPSplatFootprint(const MIPProjector &P, const double scale[2],
+  const PT *p, double value, double h, MIPSplatRecord &rec)
+{
+  const double (*r)[4] = P.Row;
+  const double X = P.Size[0], Y = P.Size[1];
+  double x = p[0], y = p[1], z = p[2];
+  double fx = x*r[0][0] + y*r[0][1] + z*r[0][2] + r[0][3];
+  double fy = x*r[1][0] + y*r[1][1] + z*r[1][2] + r[1][3];
+  double rx = h*scale[0], ry = h*scale[1];
+  if (!P.Ortho) {
+    double w = x*r[2][0] + y*r[2][1] + z*r[2][2] + r[2][3];
+    fx = fx/w + P.Offset[0];
+    fy = fy/w + P.Offset[1];
+    rx = rx/w;
+    ry = ry/w;
+  }
+  rec.Value = value;
+  if (!(rx>=1.0 || ry>=1.0)) {
+    // under a pixel (or behind the camera, or no radius)
+    if (fx>-1.0 && fx<X && fy>-1.0 && fy<Y) {
+      rec.Box[0] = rec.Box[1] = static_cast<int>(fx);
+      rec.Box[2] = rec.Box[3] = static_cast<int>(fy);
+      rec.Width  = 0;
+      return true;
+    }
+    return false;
+  }
+  // a footprint of at least one pixel radius always covers a pixel centre
+  rx = std::max(rx, 1.0);
+  ry = std::max(ry, 1.0);
+  rec.X  = fx - 0.5;
+  rec.Y  = fy - 0.5;
+  rec.SX = 1.0/rx;
+  rec.SY = 1.0/ry;
+  // clamped as doubles first, the footprint can be huge near the camera
+  double x0 = std::max(ceil(rec.X - rx), 0.0), x1 = std::min(floor(rec.X + rx), X-1.0);
+  double y0 = std::max(ceil(rec.Y - ry), 0.0), y1 = std::min(floor(rec.Y + ry), Y-1.0);
+  if (!(x0<=x1 && y0<=y1)) {
+    return false;
+  }
+  rec.Box[0] = static_cast<int>(x0);
+  rec.Box[1] = static_cast<int>(x1);
+  rec.Box[2] = static_cast<int>(y0);
+  rec.Box[3] = static_cast<int>(y1);
+  int width = rec.Box[1] - rec.Box[0] + 1;
+  rec.Width = (width<=4) ? 4 : (width<=8) ? 8 : (width<=16) ? 16 : MIP_TILE_SIZE;
+  return true;
+}
+//----------------------------------------------------------------------------
+// Draw the part x0..x1, y0..y1 of a footprint inside one tile, x1-x0 < D.
+// The squared distances (and kernel factors) of the D columns are computed
+// once with a fixed trip count. Up to 16 columns every pixel of the box is
+// tested, wider footprints only walk the chord of the disc on each row.
+template <typename K, typename Op, int D>
+static void MIPSplatDraw(const MIPSplatRecord &rec, int x0, int x1, int y0, int y1,
+  double *image, MIPIdType X)
+{
+  double dx2[D], column[D];
+  for (int i=0; i<D; i++) {
+    const double dx = (x0 + i - rec.X)*rec.SX;
+    dx2[i] = dx*dx;
+  }
+  if (K::Separable) {
+    for (int i=0; i<D; i++) {
+      column[i] = rec.Value*K::Factor(dx2[i]);
+    }
+  }
+  for (int y=y0; y<=y1; y++) {
+    const double dy  = (y - rec.Y)*rec.SY;
+    const double dy2 = dy*dy;
+    if (dy2>1.0) {
+      continue;
+    }
+    int a = 0, b = x1 - x0;
+    if (D>16) {
+      // one pixel of slack either side, the distance test is exact
+      const double half = sqrt(1.0 - dy2)/rec.SX;
+      a = std::max(a, static_cast<int>(std::max(ceil(rec.X - half) - x0 - 1.0, -1.0)));
+      b = std::min(b, static_cast<int>(std::min(floor(rec.X + half) - x0 + 1.0, 2.0*D)));
+    }
+    double *row = &image[y*X + x0];
+    const double factor = K::Factor(dy2);
+    for (int i=a; i<=b; i++) {
+      const double q2 = dx2[i] + dy2;
+      const double v = K::Separable ? column[i]*factor : rec.Value*K::Weight(std::min(q2, 1.0));
+      // select rather than branch, which pixel wins is unpredictable
+      const double old = row[i];
+      row[i] = (q2<=1.0) ? Op::Combine(old, v) : old;
+    }
+  }
+}
+//----------------------------------------------------------------------------
+// Pass 2 : draw the part of each footprint inside its tiles, called by all
+// the threads of the parallel region. The footprints of a tile are drawn in
+// particle order, so sums come out as in a serial run.
+typedef void (*MIPSplatTilesFunction)(const std::vector<MIPSplatRecord> &entries,
+  const std::vector<MIPIdType> &tileStart, int tilesX, int X, int Y, double *image);
+
+template <typename K, typename Op>
+static void MIPSplatTiles(const std::vector<MIPSplatRecord> &entries,
+  const std::vector<MIPIdType> &tileStart, int tilesX, int X, int Y, double *image)
+{
+  const int ntiles = static_cast<int>(tileStart.size()) - 1;
+#pragma omp for schedule(dynamic,4)
+  for (int t=0; t<ntiles; t++) {
+    const int tx0 = (t%tilesX)*MIP_TILE_SIZE, tx1 = std::min(tx0+MIP_TILE_SIZE, X) - 1;
+    const int ty0 = (t/tilesX)*MIP_TILE_SIZE, ty1 = std::min(ty0+MIP_TILE_SIZE, Y) - 1;
+    for (MIPIdType k=tileStart[t]; k<tileStart[t+1]; k++) {
+      const MIPSplatRecord &rec = entries[k];
+      if (rec.Width==0) {
+        Op::Accumulate(image[rec.Box[0] + static_cast<MIPIdType>(rec.Box[2])*X], rec.Value);
+        continue;
+      }
+      const int x0 = std::max(rec.Box[0], tx0), x1 = std::min(rec.Box[1], tx1);
+      const int y0 = std::max(rec.Box[2], ty0), y1 = std::min(rec.Box[3], ty1);
+      switch (rec.Width) {
+        case 4:  MIPSplatDraw<K, Op, 4>(rec, x0, x1, y0, y1, image, X); break;
+        case 8:  MIPSplatDraw<K, Op, 8>(rec, x0, x1, y0, y1, image, X); break;
+        case 16: MIPSplatDraw<K, Op,16>(rec, x0, x1, y0, y1, image, X); break;
+        default: MIPSplatDraw<K, Op, MIP_TILE_SIZE>(rec, x0, x1, y0, y1, image, X); break;
+      }
+    }
+  }
+}
+//----------------------------------------------------------------------------
+template <typename Op>
+static MIPSplatTilesFunction MIPSplatSelectTiles(int kernel)
+{
+  switch (kernel) {
+    case MIP_SPLAT_CUBIC_SPLINE: return MIPSplatTiles<MIPKernelCubicSpline, Op>;
+    case MIP_SPLAT_GAUSSIAN:     return MIPSplatTiles<MIPKernelGaussian, Op>;
+    default:                     return MIPSplatTiles<MIPKernelTopHat, Op>;
+  }
+}
+//----------------------------------------------------------------------------
+// Same structure as the binned MIPProjectPoints : each thread owns a
+// contiguous range of the batch, counts the tiles its footprints overlap,
+// the counts give every (tile, thread) pair its own range of entries,
+// then tiles are drawn independently, a tile is only written by one thread.
+// Only the drawing depends on the kernel and operator, with Count every
+// particle has the value 1.
+template <bool Count, typename PT, typename ST, typename RT>
+static void MIPSplatPointsT(const MIPView &view, const PT *points,
+  const ST *scalars, int stride, const RT *radii, int rstride,
+  const MIPIdType *index, MIPIdType N, MIPSplatTilesFunction draw, double *image)
+{
+  MIPProjector proj;
+  MIPInitializeProjector(view, proj);
+  double scale[2];
+  MIPSplatScales(proj, scale);
+  const int X = view.Size[0];
+  const int Y = view.Size[1];
+  const int tilesX = (X + MIP_TILE_SIZE - 1)/MIP_TILE_SIZE;
+  const int tilesY = (Y + MIP_TILE_SIZE - 1)/MIP_TILE_SIZE;
+  const int ntiles = tilesX*tilesY;
+  const MIPIdType batch = std::min<MIPIdType>(N, MIP_SPLAT_BATCH);
+  std::vector<MIPSplatRecord> records(batch);
+  // copies of the footprints overlapping each tile, read sequentially when drawing
+  std::vector<MIPSplatRecord> entries;
+  std::vector<MIPIdType> counts, tileStart(ntiles+1);
+  int nchunks = 1;
+#pragma omp parallel
+  {
+#pragma omp single
+    {
+#ifdef _OPENMP
+      nchunks = omp_get_num_threads();
+#endif
+      counts.resize(static_cast<size_t>(nchunks)*ntiles);
+    }
+    for (MIPIdType first=0; first<N; first+=batch) {
+      const MIPIdType n = std::min(batch, N-first);
+      //
+      // pass 1 : footprints, and the number of them overlapping each tile
+      //
+#pragma omp for schedule(static)
+      for (int c=0; c<nchunks; c++) {
+        MIPIdType *count = &counts[static_cast<size_t>(c)*ntiles];
+        std::fill(count, count+ntiles, 0);
+        for (MIPIdType i=n*c/nchunks; i<n*(c+1)/nchunks; i++) {
+          MIPIdType id = index ? index[first+i] : first+i;
+          double value = Count ? 1.0 : scalars ? static_cast<double>(scalars[id*stride]) : 0.0;
+          MIPSplatRecord &rec = records[i];
+          if (!MIPSplatFootprint(proj, scale, &points[id*3], value,
+                static_cast<double>(radii[id*rstride]), rec)) {
+            rec.Box[0] = -1;
+            continue;
+          }
+          for (int ty=rec.Box[2]/MIP_TILE_SIZE; ty<=rec.Box[3]/MIP_TILE_SIZE; ty++) {
+            for (int tx=rec.Box[0]/MIP_TILE_SIZE; tx<=rec.Box[1]/MIP_TILE_SIZE; tx++) {
+              count[ty*tilesX + tx]++;
+            }
+          }
+        }
+      }
+#pragma omp single
+      {
+        MIPIdType total = 0;
+        for (int t=0; t<ntiles; t++) {
+          tileStart[t] = total;
+          for (int c=0; c<nchunks; c++) {
+            MIPIdType k = counts[static_cast<size_t>(c)*ntiles + t];
+            counts[static_cast<size_t>(c)*ntiles + t] = total;
+            total += k;
+          }
+        }
+        tileStart[ntiles] = total;
+        entries.resize(total);
+      }
+      //
+      // list the footprints of every tile
+      //
+#pragma omp for schedule(static)
+      for (int c=0; c<nchunks; c++) {
+        MIPIdType *next = &counts[static_cast<size_t>(c)*ntiles];
+        for (MIPIdType i=n*c/nchunks; i<n*(c+1)/nchunks; i++) {
+          const MIPSplatRecord &rec = records[i];
+          if (rec.Box[0]<0) continue;
+          for (int ty=rec.Box[2]/MIP_TILE_SIZE; ty<=rec.Box[3]/MIP_TILE_SIZE; ty++) {
+            for (int tx=rec.Box[0]/MIP_TILE_SIZE; tx<=rec.Box[1]/MIP_TILE_SIZE; tx++) {
+              entries[next[ty*tilesX + tx]++] = rec;
+            }
+          }
+        }
+      }
+      //
+      // pass 2 : draw the part of each footprint inside the tile
+      //
+      draw(entries, tileStart, tilesX, X, Y, image);
+    }
+  }
+}
+//----------------------------------------------------------------------------
+template <typename PT, typename ST, typename RT>
+void MIPSplatPoints(const MIPView &view, const PT *points,
+  const ST *scalars, int stride, const RT *radii, int rstride,
+  const MIPIdType *index, MIPIdType N, int kernel, double *image)
+{
+  if (N<=0) {
+    return;
+  }
+  MIPSplatTilesFunction draw = NULL;
+  MIP_OPERATOR_DISPATCH(view.Operator, draw = MIPSplatSelectTiles<MIPOp>(kernel));
+  if (view.Operator==MIP_OPERATOR_COUNT) {
+    MIPSplatPointsT<true>(view, points, scalars, stride,
+      radii, rstride, index, N, draw, image);
+  }
+  else {
+    MIPSplatPointsT<false>(view, points, scalars, stride,
+      radii, rstride, index, N, draw, image);
+  }
+}
+//----------------------------------------------------------------------------
+#define MIP_INSTANTIATE_SPLAT_RT(PT, ST, RT) \
+  template void MIPSplatPoints<PT, ST, RT>(const MIPView &, const PT *, \
+    const ST *, int, const RT *, int, const MIPIdType *, MIPIdType, int, double *);
+#define MIP_INSTANTIATE_SPLAT(ST) \
+  MIP_INSTANTIATE_SPLAT_RT(float,  ST, float) \
+  MIP_INSTANTIATE_SPLAT_RT(float,  ST, double) \
+  MIP_INSTANTIATE_SPLAT_RT(double, ST, float) \
+  MIP_INSTANTIATE_SPLAT_RT(double, ST, double)
+MIP_FOREACH_SCALAR_TYPE(MIP_INSTANTIATE_SPLAT)
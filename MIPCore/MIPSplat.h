@@ -0,0 +1,67 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPSplat.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPSplat - projection of particles with a smoothing length
+// .SECTION Description
+// SPH particles cover a sphere of radius h (the support of their kernel),
+// drawing them as single pixels leaves close-ups as sparse noise. Here each
+// particle is splatted over the disc its sphere projects to, the value
+// accumulated into a pixel (with view.Operator) is the particle scalar
+// weighted by the kernel at the pixel's distance from the centre (scaled
+// so the weight is 1 at the centre, which assumes non negative scalars for
+// the smooth kernels). The weights are not normalized to a unit integral,
+// so sums are smoothed sums of the scalars rather than column integrals.
+//
+// Particles are rasterized in MIP_TILE_SIZE screen tiles : every particle
+// is binned into all the tiles its footprint overlaps, then the tiles are
+// drawn independently by the threads, so one large footprint is shared by
+// many threads and the cost is proportional to the pixels covered.
+// Footprints with a radius under one pixel are drawn as the single pixel
+// MIPProjectPoints would use, small ones with rows of a fixed compile-time
+// width.
+//
+// .SECTION See Also
+// MIPProjection vtkMIPPainter
+
+#ifndef __MIPSplat_h
+#define __MIPSplat_h
+
+#include "MIPProjection.h"
+
+// Kernels used to weight the footprint of a particle, q = r/h
+enum
+{
+  // constant 1 over the whole disc
+  MIP_SPLAT_TOPHAT        = 0,
+  // the M4 cubic spline of SPH codes (with compact support h)
+  MIP_SPLAT_CUBIC_SPLINE  = 1,
+  // exp(-4.5 q^2), a gaussian truncated at 3 sigma
+  MIP_SPLAT_GAUSSIAN      = 2
+};
+
+// Description:
+// Splat N particles (xyz interleaved) into the image, accumulating the
+// values per pixel with view.Operator. Particle i has the value scalars[i*stride] (0 if scalars is NULL)
+// and the radius radii[i*rstride], in world units. If index is not NULL
+// only the particles index[0..N-1] are drawn. Radii that are not positive
+// (or NaN) give single pixel particles. The image must have
+// view.Size[0]*view.Size[1] pixels and is not cleared.
+// Instantiated for float/double points and radii and all types of
+// MIP_FOREACH_SCALAR_TYPE.
+template <typename PT, typename ST, typename RT>
+void MIPSplatPoints(const MIPView &view, const PT *points,
+  const ST *scalars, int stride, const RT *radii, int rstride,
+  const MIPIdType *index, MIPIdType N, int kernel, double *image);
+
+#endif
@@ -0,0 +1,86 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPSubsample.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPSubsample.h"
+#include "MIPScalars.h"
+
+//----------------------------------------------------------------------------
+// Round function of the Feistel network, a 64 bit integer hash
+static inline unsigned long long MIPPermuteRound(unsigned long long x, int round)
+{
+  x += 0x9E3779B97F4A7C15ULL*(round+1);
+  x = (x ^ (x >> 30))*0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27))*0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+//----------------------------------------------------------------------------
+// A 4 round Feistel network is a bijection of [0, 4^h) for any round
+// function. Choosing 4^h >= N and re-applying it to values >= N (cycle
+// walking) gives a bijection of [0, N), 4^h < 4N so this takes less than
+// 4 steps on average.
+MIPIdType MIPPermute(MIPIdType i, MIPIdType N)
+{
+  int h = 1;
+  while ((1ULL << (2*h)) < static_cast<unsigned long long>(N)) h++;
+  const unsigned long long mask = (1ULL << h) - 1;
+  unsigned long long x = static_cast<unsigned long long>(i);
+  do {
+    unsigned long long l = x >> h, r = x & mask;
+    for (int round=0; round<4; round++) {
+      unsigned long long t = r;
+      r = l ^ (MIPPermuteRound(r, round) & mask);
+      l = t;
+    }
+    x = (l << h) | r;
+  } while (x>=static_cast<unsigned long long>(N));
+  return static_cast<MIPIdType>(x);
+}
+//----------------------------------------------------------------------------
+static inline std::vector<float> &MIPSubsamplePoints(MIPSubsample &s, const float *)
+{
+  s.PointsD.clear();
+  return s.PointsF;
+}
+static inline std::vector<double> &MIPSubsamplePoints(MIPSubsample &s, const double *)
+{
+  s.PointsF.clear();
+  return s.PointsD;
+}
+//----------------------------------------------------------------------------
+template <typename PT, typename ST>
+void MIPBuildSubsample(const PT *points, const ST *scalars, int stride,
+  const MIPIdType *ids, MIPIdType N, MIPSubsample &subsample)
+{
+  std::vector<PT> &spoints = MIPSubsamplePoints(subsample, points);
+  spoints.resize(N*3);
+  subsample.Values.resize(N);
+  subsample.Index.resize(N);
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<N; i++) {
+    MIPIdType p  = MIPPermute(i, N);
+    MIPIdType id = ids ? ids[p] : p;
+    spoints[i*3+0] = points[id*3+0];
+    spoints[i*3+1] = points[id*3+1];
+    spoints[i*3+2] = points[id*3+2];
+    subsample.Values[i] = scalars ? static_cast<double>(scalars[id*stride]) : 0.0;
+    subsample.Index[i]  = id;
+  }
+}
+//----------------------------------------------------------------------------
+#define MIP_INSTANTIATE_SUBSAMPLE(ST) \
+  template void MIPBuildSubsample<float, ST>(const float *, const ST *, int, \
+    const MIPIdType *, MIPIdType, MIPSubsample &); \
+  template void MIPBuildSubsample<double, ST>(const double *, const ST *, int, \
+    const MIPIdType *, MIPIdType, MIPSubsample &);
+MIP_FOREACH_SCALAR_TYPE(MIP_INSTANTIATE_SUBSAMPLE)
@@ -0,0 +1,62 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPSubsample.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPSubsample - particles in a stable random order for progressive LOD
+// .SECTION Description
+// A copy of the particles shuffled by a fixed random permutation. Any
+// prefix of it is a uniform random subsample of the data, so an interactive
+// frame can project the first n particles (n chosen to fit a time budget)
+// and later frames refine by projecting the next ranges on top of the same
+// image, until all particles are drawn. The permutation only depends on the
+// number of particles, the same subsample is drawn for every camera, which
+// avoids flickering during interaction.
+//
+// .SECTION See Also
+// MIPProjection vtkMIPPainter
+
+#ifndef __MIPSubsample_h
+#define __MIPSubsample_h
+
+#include "MIPProjection.h"
+
+#include <vector>
+
+//----------------------------------------------------------------------------
+// Description:
+// The shuffled particles, ranges are projected with MIPProjectPoints using
+// &Points[begin*3] and &Values[begin]. Points are kept in their input
+// precision, only one of PointsF/PointsD is used.
+struct MIPSubsample
+{
+  std::vector<float>     PointsF;
+  std::vector<double>    PointsD;
+  std::vector<double>    Values;
+  // id of the particles in the input
+  std::vector<MIPIdType> Index;
+};
+
+// Description:
+// Position of particle i in a pseudo random permutation of 0..N-1, this
+// is a bijection computed independently for every i (so in parallel).
+MIPIdType MIPPermute(MIPIdType i, MIPIdType N);
+
+// Description:
+// Shuffle the N particles ids[0..N-1], or particles 0..N-1 if ids is NULL,
+// into the subsample. The scalars are read like in MIPProjectPoints.
+// Instantiated for float/double points and all types of MIP_FOREACH_SCALAR_TYPE.
+template <typename PT, typename ST>
+void MIPBuildSubsample(const PT *points, const ST *scalars, int stride,
+  const MIPIdType *ids, MIPIdType N, MIPSubsample &subsample);
+
+#endif
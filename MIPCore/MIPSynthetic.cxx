@@ -0,0 +1,210 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPSynthetic.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPSynthetic.h"
+#include "MIPOperator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define MIP_SYNTHETIC_HALO_COUNT 100
+
+//----------------------------------------------------------------------------
+// splitmix64, a full period hash of a 64 bit counter
+static inline unsigned long long MIPSyntheticHash(unsigned long long x)
+{
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+//----------------------------------------------------------------------------
+// Random stream of one particle, uniform doubles in [0,1)
+struct MIPSyntheticStream
+{
+  unsigned long long State;
+  MIPSyntheticStream(unsigned long long seed, unsigned long long i)
+    : State(MIPSyntheticHash(seed ^ MIPSyntheticHash(i))) {}
+  double Next()
+  {
+    this->State = MIPSyntheticHash(this->State);
+    return (this->State >> 11)*(1.0/9007199254740992.0);
+  }
+};
+//----------------------------------------------------------------------------
+// Offset of a Plummer sphere particle of scale radius a, truncated so that
+// 99% of the mass is kept (about 12a), returns r/a
+static double MIPSyntheticPlummer(MIPSyntheticStream &s, double a, double offset[3])
+{
+  double m = 0.99*s.Next() + 1.0e-12;
+  double q = 1.0/sqrt(pow(m, -2.0/3.0) - 1.0);
+  double z = 2.0*s.Next() - 1.0;
+  double phi = 2.0*3.14159265358979*s.Next();
+  double rxy = sqrt(std::max(1.0 - z*z, 0.0));
+  offset[0] = a*q*rxy*cos(phi);
+  offset[1] = a*q*rxy*sin(phi);
+  offset[2] = a*q*z;
+  return q;
+}
+//----------------------------------------------------------------------------
+// Density of a Plummer sphere at r/a, relative to the centre
+static inline double MIPSyntheticPlummerDensity(double q)
+{
+  return pow(1.0 + q*q, -2.5);
+}
+//----------------------------------------------------------------------------
+const char *MIPSyntheticName(int distribution)
+{
+  switch (distribution) {
+    case MIP_SYNTHETIC_UNIFORM: return "uniform";
+    case MIP_SYNTHETIC_PLUMMER: return "plummer";
+    case MIP_SYNTHETIC_HALOS:   return "halos";
+    default:                    return "unknown";
+  }
+}
+//----------------------------------------------------------------------------
+int MIPSyntheticFromName(const char *name)
+{
+  for (int d=MIP_SYNTHETIC_UNIFORM; d<=MIP_SYNTHETIC_HALOS; d++) {
+    if (strcmp(name, MIPSyntheticName(d))==0) {
+      return d;
+    }
+  }
+  return -1;
+}
+//----------------------------------------------------------------------------
+void MIPGenerateParticles(int distribution, unsigned long long seed,
+  MIPIdType first, MIPIdType N, float *points, float *scalars)
+{
+  //
+  // the halos are drawn from the seed alone, masses follow 1/k
+  //
+  double centres[MIP_SYNTHETIC_HALO_COUNT][3], scales[MIP_SYNTHETIC_HALO_COUNT];
+  double masses[MIP_SYNTHETIC_HALO_COUNT], cumulative[MIP_SYNTHETIC_HALO_COUNT];
+  double total = 0.0;
+  for (int k=0; k<MIP_SYNTHETIC_HALO_COUNT; k++) {
+    MIPSyntheticStream s(~seed, k);
+    for (int c=0; c<3; c++) {
+      centres[k][c] = 0.15 + 0.7*s.Next();
+    }
+    masses[k] = 1.0/(k+1);
+    // size grows like the cube root of the mass
+    scales[k] = 0.02*cbrt(masses[k]);
+    total += masses[k];
+    cumulative[k] = total;
+  }
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<N; i++) {
+    MIPSyntheticStream s(seed, static_cast<unsigned long long>(first+i));
+    double p[3], value;
+    if (distribution==MIP_SYNTHETIC_PLUMMER) {
+      double offset[3];
+      double q = MIPSyntheticPlummer(s, 0.1, offset);
+      for (int c=0; c<3; c++) {
+        p[c] = 0.5 + offset[c];
+      }
+      value = MIPSyntheticPlummerDensity(q);
+    }
+    else if (distribution==MIP_SYNTHETIC_HALOS && s.Next()>=0.1) {
+      double u = s.Next()*total;
+      int k = static_cast<int>(std::upper_bound(cumulative,
+        cumulative+MIP_SYNTHETIC_HALO_COUNT, u) - cumulative);
+      k = std::min(k, MIP_SYNTHETIC_HALO_COUNT-1);
+      double offset[3];
+      double q = MIPSyntheticPlummer(s, scales[k], offset);
+      for (int c=0; c<3; c++) {
+        p[c] = centres[k][c] + offset[c];
+      }
+      // denser in the core of the more massive halos
+      value = masses[k]*MIPSyntheticPlummerDensity(q)/(scales[k]*scales[k]*scales[k]);
+    }
+    else {
+      for (int c=0; c<3; c++) {
+        p[c] = s.Next();
+      }
+      value = (distribution==MIP_SYNTHETIC_HALOS) ? 0.0 : s.Next();
+    }
+    for (int c=0; c<3; c++) {
+      points[i*3+c] = static_cast<float>(std::min(std::max(p[c], 0.0), 1.0));
+    }
+    scalars[i] = static_cast<float>(value);
+  }
+}
+//----------------------------------------------------------------------------
+void MIPSyntheticView(int X, int Y, MIPView &view)
+{
+  const double fov = 30.0*3.14159265358979/180.0;
+  const double f = 1.0/tan(fov/2.0);
+  const double a = static_cast<double>(X)/Y;
+  const double n = 0.1, fr = 10.0;
+  const double A = (n+fr)/(n-fr), B = 2.0*n*fr/(n-fr);
+  const double eye[3] = {0.5, 0.5, 3.0};
+  double m[4][4] = {
+    {f/a, 0.0, 0.0, -eye[0]*f/a},
+    {0.0, f,   0.0, -eye[1]*f},
+    {0.0, 0.0, A,   -eye[2]*A + B},
+    {0.0, 0.0, -1.0, eye[2]}
+  };
+  memcpy(view.Matrix, m, sizeof(m));
+  view.ViewPortRatio[0] = X/2.0;
+  view.ViewPortRatio[1] = Y/2.0;
+  view.Size[0] = X;
+  view.Size[1] = Y;
+  view.TileBinning = false;
+  view.Operator = MIP_OPERATOR_MAX;
+}
+//----------------------------------------------------------------------------
+void MIPSyntheticOrthographicView(int X, int Y, MIPView &view)
+{
+  MIPSyntheticView(X, Y, view);
+  const double a = static_cast<double>(X)/Y;
+  double m[4][4] = {
+    {2.0/a, 0.0, 0.0, -1.0/a},
+    {0.0,   2.0, 0.0, -1.0},
+    {0.0,   0.0, -0.1, 0.0},
+    {0.0,   0.0, 0.0, 1.0}
+  };
+  memcpy(view.Matrix, m, sizeof(m));
+}
+//----------------------------------------------------------------------------
+void MIPSyntheticGreyTable(MIPColourTable &table)
+{
+  std::vector<double> values;
+  const double range[2] = {0.0, 1.0};
+  MIPInitializeColourTable(table, MIP_COLOUR_TABLE_SIZE, range, false, values);
+  for (int i=0; i<MIP_COLOUR_TABLE_SIZE; i++) {
+    unsigned char grey = static_cast<unsigned char>(values[i]*255.0);
+    table.RGBA[i*4+0] = table.RGBA[i*4+1] = table.RGBA[i*4+2] = grey;
+    table.RGBA[i*4+3] = 255;
+  }
+  // clamped, NaN black
+  memcpy(table.Below, &table.RGBA[0], 4);
+  memcpy(table.Above, &table.RGBA[(MIP_COLOUR_TABLE_SIZE-1)*4], 4);
+  table.NaN[3] = 255;
+}
+//----------------------------------------------------------------------------
+void MIPSyntheticSetThreads(int threads)
+{
+#ifdef _OPENMP
+  omp_set_num_threads(threads);
+#else
+  (void)threads;
+#endif
+}
@@ -0,0 +1,78 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPSynthetic.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPSynthetic - deterministic particle clouds for benchmarking
+// .SECTION Description
+// Particle i of a cloud only depends on the distribution, the seed and i
+// (it is drawn from a counter based hash), so any slice [first, first+N)
+// can be generated on its own, in parallel, and the union of the slices of
+// all processes is the same cloud whatever the number of processes or
+// threads. All clouds fit in the unit cube.
+// Also holds the cameras, colour table and thread setting shared by the
+// benchmark drivers and the checks.
+//
+// .SECTION See Also
+// MIPScaling MIPBenchmark
+
+#ifndef __MIPSynthetic_h
+#define __MIPSynthetic_h
+
+#include "MIPProjection.h"
+#include "MIPColourMap.h"
+
+enum
+{
+  // uniform positions and scalars
+  MIP_SYNTHETIC_UNIFORM = 0,
+  // one Plummer sphere (scale radius 0.1) centred in the cube, the scalar
+  // is the density at the particle
+  MIP_SYNTHETIC_PLUMMER = 1,
+  // 100 Plummer halos with Zipf distributed masses over a 10% uniform
+  // background, the scalar is the density of the particle's halo
+  MIP_SYNTHETIC_HALOS   = 2
+};
+
+// Description:
+// Name of a distribution ("uniform", "plummer", "halos"), and the reverse,
+// -1 for an unknown name.
+const char *MIPSyntheticName(int distribution);
+int         MIPSyntheticFromName(const char *name);
+
+// Description:
+// Generate particles first..first+N-1 of a cloud, xyz interleaved points
+// and one scalar per particle.
+void MIPGenerateParticles(int distribution, unsigned long long seed,
+  MIPIdType first, MIPIdType N, float *points, float *scalars);
+
+// Description:
+// Perspective camera looking down -z at the unit cube for an X*Y image,
+// the same matrix layout as vtkCamera::GetCompositeProjectionTransformMatrix.
+// Max operator, no tile binning.
+void MIPSyntheticView(int X, int Y, MIPView &view);
+
+// Description:
+// Orthographic camera looking down -z at the unit cube for an X*Y image,
+// otherwise as MIPSyntheticView.
+void MIPSyntheticOrthographicView(int X, int Y, MIPView &view);
+
+// Description:
+// A grey ramp over [0, 1], enough to time the colour mapping.
+void MIPSyntheticGreyTable(MIPColourTable &table);
+
+// Description:
+// Number of OpenMP threads of the following parallel regions, ignored
+// without OpenMP.
+void MIPSyntheticSetThreads(int threads);
+
+#endif
@@ -0,0 +1,296 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPTransform.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPTransform.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #include <immintrin.h>
+  #define MIP_HAVE_AVX2
+  #define MIP_HAVE_AVX512
+  #define MIP_TARGET_AVX2   __attribute__((target("avx2")))
+  #define MIP_TARGET_AVX512 __attribute__((target("avx512f")))
+  #define MIP_CPU_SUPPORTS(x) __builtin_cpu_supports(x)
+#elif defined(_MSC_VER) && defined(__AVX2__)
+  // MSVC has no per-function targets, use what the build was compiled for
+  #include <immintrin.h>
+  #define MIP_HAVE_AVX2
+  #define MIP_TARGET_AVX2
+  #define MIP_CPU_SUPPORTS(x) (strcmp(x, "avx2")==0)
+  #if defined(__AVX512F__)
+    #define MIP_HAVE_AVX512
+    #define MIP_TARGET_AVX512
+    #undef  MIP_CPU_SUPPORTS
+    #define MIP_CPU_SUPPORTS(x) 1
+  #endif
+#endif
+
+enum MIPInstructionSet { MIP_SCALAR=0, MIP_AVX2, MIP_AVX512 };
+
+//----------------------------------------------------------------------------
+void MIPInitializeProjector(const MIPView &view, MIPProjector &proj)
+{
+  const double (*m)[4] = view.Matrix;
+  const double r[2] = { view.ViewPortRatio[0], view.ViewPortRatio[1] };
+  proj.Size[0] = view.Size[0];
+  proj.Size[1] = view.Size[1];
+  proj.Ortho = (m[3][0]==0.0 && m[3][1]==0.0 && m[3][2]==0.0 && m[3][3]!=0.0);
+  // pixel = (ndc + 1)*ratio + 0.5
+  for (int j=0; j<2; j++) {
+    if (proj.Ortho) {
+      double s = r[j]/m[3][3];
+      proj.Row[j][0] = m[j][0]*s;
+      proj.Row[j][1] = m[j][1]*s;
+      proj.Row[j][2] = m[j][2]*s;
+      proj.Row[j][3] = m[j][3]*s + r[j] + 0.5;
+      proj.Offset[j] = 0.0;
+    }
+    else {
+      proj.Row[j][0] = m[j][0]*r[j];
+      proj.Row[j][1] = m[j][1]*r[j];
+      proj.Row[j][2] = m[j][2]*r[j];
+      proj.Row[j][3] = m[j][3]*r[j];
+      proj.Offset[j] = r[j] + 0.5;
+    }
+  }
+  for (int k=0; k<4; k++) {
+    proj.Row[2][k] = m[3][k];
+  }
+}
+//----------------------------------------------------------------------------
+// Reference kernel, the SIMD versions below must perform the same operations
+// in the same order. A pixel is valid if -1 < f < size, which is exactly the
+// range that truncates to [0, size), NaN and inf (w==0) fail the test.
+template <typename PT, bool Ortho>
+static void MIPTransformScalar(const MIPProjector &P, const PT *points,
+  MIPIdType n, int *ix, int *iy)
+{
+  const double (*r)[4] = P.Row;
+  const double X = P.Size[0], Y = P.Size[1];
+  for (MIPIdType i=0; i<n; i++) {
+    double x = points[i*3+0], y = points[i*3+1], z = points[i*3+2];
+    double fx = x*r[0][0] + y*r[0][1] + z*r[0][2] + r[0][3];
+    double fy = x*r[1][0] + y*r[1][1] + z*r[1][2] + r[1][3];
+    if (!Ortho) {
+      double w = x*r[2][0] + y*r[2][1] + z*r[2][2] + r[2][3];
+      fx = fx/w + P.Offset[0];
+      fy = fy/w + P.Offset[1];
+    }
+    if (fx>-1.0 && fx<X && fy>-1.0 && fy<Y) {
+      ix[i] = static_cast<int>(fx);
+      iy[i] = static_cast<int>(fy);
+    }
+    else {
+      ix[i] = -1;
+    }
+  }
+}
+
+#ifdef MIP_HAVE_AVX2
+//----------------------------------------------------------------------------
+MIP_TARGET_AVX2 static inline void MIPLoad4(const double *p,
+  __m256d &x, __m256d &y, __m256d &z)
+{
+  const __m128i idx = _mm_setr_epi32(0, 3, 6, 9);
+  x = _mm256_i32gather_pd(p+0, idx, 8);
+  y = _mm256_i32gather_pd(p+1, idx, 8);
+  z = _mm256_i32gather_pd(p+2, idx, 8);
+}
+//----------------------------------------------------------------------------
+MIP_TARGET_AVX2 static inline void MIPLoad4(const float *p,
+  __m256d &x, __m256d &y, __m256d &z)
+{
+  const __m128i idx = _mm_setr_epi32(0, 3, 6, 9);
+  x = _mm256_cvtps_pd(_mm_i32gather_ps(p+0, idx, 4));
+  y = _mm256_cvtps_pd(_mm_i32gather_ps(p+1, idx, 4));
+  z = _mm256_cvtps_pd(_mm_i32gather_ps(p+2, idx, 4));
+}
+//----------------------------------------------------------------------------
+MIP_TARGET_AVX2 static inline __m256d MIPDot4(const double *r,
+  __m256d x, __m256d y, __m256d z)
+{
+  __m256d v = _mm256_add_pd(
+    _mm256_mul_pd(x, _mm256_set1_pd(r[0])), _mm256_mul_pd(y, _mm256_set1_pd(r[1])));
+  v = _mm256_add_pd(v, _mm256_mul_pd(z, _mm256_set1_pd(r[2])));
+  return _mm256_add_pd(v, _mm256_set1_pd(r[3]));
+}
+//----------------------------------------------------------------------------
+template <typename PT, bool Ortho>
+MIP_TARGET_AVX2 static void MIPTransformAVX2(const MIPProjector &P,
+  const PT *points, MIPIdType n, int *ix, int *iy)
+{
+  const __m256d minus1 = _mm256_set1_pd(-1.0);
+  const __m256d X = _mm256_set1_pd(P.Size[0]);
+  const __m256d Y = _mm256_set1_pd(P.Size[1]);
+  const __m256d ox = _mm256_set1_pd(P.Offset[0]);
+  const __m256d oy = _mm256_set1_pd(P.Offset[1]);
+  MIPIdType i = 0;
+  for (; i+4<=n; i+=4) {
+    __m256d x, y, z;
+    MIPLoad4(&points[i*3], x, y, z);
+    __m256d fx = MIPDot4(P.Row[0], x, y, z);
+    __m256d fy = MIPDot4(P.Row[1], x, y, z);
+    if (!Ortho) {
+      __m256d w = MIPDot4(P.Row[2], x, y, z);
+      fx = _mm256_add_pd(_mm256_div_pd(fx, w), ox);
+      fy = _mm256_add_pd(_mm256_div_pd(fy, w), oy);
+    }
+    __m256d valid = _mm256_and_pd(
+      _mm256_and_pd(_mm256_cmp_pd(fx, minus1, _CMP_GT_OQ), _mm256_cmp_pd(fx, X, _CMP_LT_OQ)),
+      _mm256_and_pd(_mm256_cmp_pd(fy, minus1, _CMP_GT_OQ), _mm256_cmp_pd(fy, Y, _CMP_LT_OQ)));
+    // invalid lanes truncate to -1
+    fx = _mm256_blendv_pd(minus1, fx, valid);
+    fy = _mm256_blendv_pd(minus1, fy, valid);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&ix[i]), _mm256_cvttpd_epi32(fx));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&iy[i]), _mm256_cvttpd_epi32(fy));
+  }
+  MIPTransformScalar<PT, Ortho>(P, &points[i*3], n-i, &ix[i], &iy[i]);
+}
+#endif
+
+#ifdef MIP_HAVE_AVX512
+//----------------------------------------------------------------------------
+MIP_TARGET_AVX512 static inline void MIPLoad8(const double *p,
+  __m512d &x, __m512d &y, __m512d &z)
+{
+  const __m256i idx = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+  x = _mm512_i32gather_pd(idx, p+0, 8);
+  y = _mm512_i32gather_pd(idx, p+1, 8);
+  z = _mm512_i32gather_pd(idx, p+2, 8);
+}
+//----------------------------------------------------------------------------
+MIP_TARGET_AVX512 static inline void MIPLoad8(const float *p,
+  __m512d &x, __m512d &y, __m512d &z)
+{
+  const __m256i idx = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+  x = _mm512_cvtps_pd(_mm256_i32gather_ps(p+0, idx, 4));
+  y = _mm512_cvtps_pd(_mm256_i32gather_ps(p+1, idx, 4));
+  z = _mm512_cvtps_pd(_mm256_i32gather_ps(p+2, idx, 4));
+}
+//----------------------------------------------------------------------------
+MIP_TARGET_AVX512 static inline __m512d MIPDot8(const double *r,
+  __m512d x, __m512d y, __m512d z)
+{
+  __m512d v = _mm512_add_pd(
+    _mm512_mul_pd(x, _mm512_set1_pd(r[0])), _mm512_mul_pd(y, _mm512_set1_pd(r[1])));
+  v = _mm512_add_pd(v, _mm512_mul_pd(z, _mm512_set1_pd(r[2])));
+  return _mm512_add_pd(v, _mm512_set1_pd(r[3]));
+}
+//----------------------------------------------------------------------------
+template <typename PT, bool Ortho>
+MIP_TARGET_AVX512 static void MIPTransformAVX512(const MIPProjector &P,
+  const PT *points, MIPIdType n, int *ix, int *iy)
+{
+  const __m512d minus1 = _mm512_set1_pd(-1.0);
+  const __m512d X = _mm512_set1_pd(P.Size[0]);
+  const __m512d Y = _mm512_set1_pd(P.Size[1]);
+  const __m512d ox = _mm512_set1_pd(P.Offset[0]);
+  const __m512d oy = _mm512_set1_pd(P.Offset[1]);
+  MIPIdType i = 0;
+  for (; i+8<=n; i+=8) {
+    __m512d x, y, z;
+    MIPLoad8(&points[i*3], x, y, z);
+    __m512d fx = MIPDot8(P.Row[0], x, y, z);
+    __m512d fy = MIPDot8(P.Row[1], x, y, z);
+    if (!Ortho) {
+      __m512d w = MIPDot8(P.Row[2], x, y, z);
+      fx = _mm512_add_pd(_mm512_div_pd(fx, w), ox);
+      fy = _mm512_add_pd(_mm512_div_pd(fy, w), oy);
+    }
+    __mmask8 valid =
+      _mm512_cmp_pd_mask(fx, minus1, _CMP_GT_OQ) & _mm512_cmp_pd_mask(fx, X, _CMP_LT_OQ) &
+      _mm512_cmp_pd_mask(fy, minus1, _CMP_GT_OQ) & _mm512_cmp_pd_mask(fy, Y, _CMP_LT_OQ);
+    // invalid lanes truncate to -1
+    fx = _mm512_mask_blend_pd(valid, minus1, fx);
+    fy = _mm512_mask_blend_pd(valid, minus1, fy);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&ix[i]), _mm512_cvttpd_epi32(fx));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&iy[i]), _mm512_cvttpd_epi32(fy));
+  }
+  MIPTransformScalar<PT, Ortho>(P, &points[i*3], n-i, &ix[i], &iy[i]);
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Best instruction set supported by the CPU, or the one forced by MIP_SIMD.
+static int MIPDetectInstructionSet()
+{
+  int best = MIP_SCALAR;
+#ifdef MIP_HAVE_AVX2
+  if (MIP_CPU_SUPPORTS("avx2")) best = MIP_AVX2;
+#endif
+#ifdef MIP_HAVE_AVX512
+  if (MIP_CPU_SUPPORTS("avx512f")) best = MIP_AVX512;
+#endif
+  const char *env = getenv("MIP_SIMD");
+  if (env) {
+    int requested = best;
+    if (strcmp(env, "scalar")==0) requested = MIP_SCALAR;
+    else if (strcmp(env, "avx2")==0) requested = MIP_AVX2;
+    else if (strcmp(env, "avx512")==0) requested = MIP_AVX512;
+    // never select something the CPU cannot run
+    best = (requested<best) ? requested : best;
+  }
+  return best;
+}
+//----------------------------------------------------------------------------
+static int MIPInstructionSet()
+{
+  static const int isa = MIPDetectInstructionSet();
+  return isa;
+}
+//----------------------------------------------------------------------------
+const char *MIPTransformInstructionSet()
+{
+  switch (MIPInstructionSet()) {
+    case MIP_AVX512: return "avx512";
+    case MIP_AVX2:   return "avx2";
+    default:         return "scalar";
+  }
+}
+//----------------------------------------------------------------------------
+template <typename PT, bool Ortho>
+static void MIPTransformDispatch(const MIPProjector &proj, const PT *points,
+  MIPIdType n, int *ix, int *iy)
+{
+  switch (MIPInstructionSet()) {
+#ifdef MIP_HAVE_AVX512
+    case MIP_AVX512:
+      MIPTransformAVX512<PT, Ortho>(proj, points, n, ix, iy);
+      return;
+#endif
+#ifdef MIP_HAVE_AVX2
+    case MIP_AVX2:
+      MIPTransformAVX2<PT, Ortho>(proj, points, n, ix, iy);
+      return;
+#endif
+    default:
+      MIPTransformScalar<PT, Ortho>(proj, points, n, ix, iy);
+  }
+}
+//----------------------------------------------------------------------------
+void MIPTransformPoints(const MIPProjector &proj, const float *points,
+  MIPIdType n, int *ix, int *iy)
+{
+  if (proj.Ortho) MIPTransformDispatch<float, true>(proj, points, n, ix, iy);
+  else            MIPTransformDispatch<float, false>(proj, points, n, ix, iy);
+}
+//----------------------------------------------------------------------------
+void MIPTransformPoints(const MIPProjector &proj, const double *points,
+  MIPIdType n, int *ix, int *iy)
+{
+  if (proj.Ortho) MIPTransformDispatch<double, true>(proj, points, n, ix, iy);
+  else            MIPTransformDispatch<double, false>(proj, points, n, ix, iy);
+}
@@ -0,0 +1,67 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPTransform.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPTransform - world to pixel transformation of particle blocks
+// .SECTION Description
+// Converts blocks of xyz positions into integer pixel coordinates.
+// Kernels are specialized at compile time for float/double positions and
+// for perspective/orthographic cameras (w is constant for the latter, so
+// the divide is folded into the coefficients). AVX2 and AVX-512 versions
+// are selected at run time when the CPU supports them, with a scalar
+// fallback. All variants use the same operation order so they give the
+// same pixels. The environment variable MIP_SIMD=scalar|avx2|avx512 can be
+// used to force a particular instruction set when benchmarking.
+//
+// .SECTION See Also
+// MIPProjection
+
+#ifndef __MIPTransform_h
+#define __MIPTransform_h
+
+#include "MIPProjection.h"
+
+// Number of points transformed per call by the projection kernels,
+// the pixel coordinates of one block stay in L1 cache.
+#define MIP_TRANSFORM_BLOCK 512
+
+//----------------------------------------------------------------------------
+// Description:
+// The MIPView matrix pre-scaled to pixel units.
+// Perspective : pixel = Row[0..1].p / Row[2].p + Offset
+// Orthographic: pixel = Row[0..1].p (the constant w and Offset are folded in)
+struct MIPProjector
+{
+  double Row[3][4];
+  double Offset[2];
+  bool   Ortho;
+  int    Size[2];
+};
+
+// Description:
+// Precompute the projector for a view.
+void MIPInitializeProjector(const MIPView &view, MIPProjector &proj);
+
+// Description:
+// Transform n points (xyz interleaved) to pixels. Points that fall outside
+// the image, or cannot be projected, get ix[i] = -1.
+void MIPTransformPoints(const MIPProjector &proj, const float *points,
+  MIPIdType n, int *ix, int *iy);
+void MIPTransformPoints(const MIPProjector &proj, const double *points,
+  MIPIdType n, int *ix, int *iy);
+
+// Description:
+// Name of the instruction set used by MIPTransformPoints on this machine.
+const char *MIPTransformInstructionSet();
+
+#endif
@@ -0,0 +1,354 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPTree.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "MIPTree.h"
+#include "MIPOperator.h"
+#include "MIPScalars.h"
+#include "MIPTransform.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Subtrees with more particles than this are built as separate tasks
+#define MIP_TREE_TASK_SIZE 65536
+
+//----------------------------------------------------------------------------
+// Number of nodes of the tree over n particles, the median split makes the
+// shape depend on n only so the nodes can be allocated (and numbered in
+// depth first order) before the parallel build.
+static int MIPTreeNodeCount(MIPIdType n)
+{
+  if (n<=MIP_TREE_LEAF_SIZE) {
+    return 1;
+  }
+  return 1 + MIPTreeNodeCount(n/2) + MIPTreeNodeCount(n-n/2);
+}
+//----------------------------------------------------------------------------
+// The particles are sorted as self contained items, the splits then only
+// stream through memory instead of chasing ids into the input arrays.
+template <typename PT>
+struct MIPTreeItem
+{
+  PT        P[3];
+  double    Value;
+  MIPIdType Id;
+};
+//----------------------------------------------------------------------------
+// NaN coordinates are sorted last so the comparison stays a strict ordering
+template <typename PT>
+struct MIPTreeAxisLess
+{
+  int Axis;
+  bool operator()(const MIPTreeItem<PT> &a, const MIPTreeItem<PT> &b) const
+  {
+    PT pa = a.P[this->Axis], pb = b.P[this->Axis];
+    if (pb!=pb) return pa==pa;
+    return pa<pb;
+  }
+};
+//----------------------------------------------------------------------------
+template <typename PT>
+struct MIPTreeBuilder
+{
+  MIPTreeItem<PT> *Items;
+  MIPTree         *Tree;
+
+  void Bounds(MIPIdType begin, MIPIdType end, double bounds[6])
+  {
+    for (int j=0; j<3; j++) {
+      bounds[j*2]   =  HUGE_VAL;
+      bounds[j*2+1] = -HUGE_VAL;
+    }
+    for (MIPIdType i=begin; i<end; i++) {
+      const PT *p = this->Items[i].P;
+      for (int j=0; j<3; j++) {
+        // NaN fails both tests and is ignored
+        if (p[j]<bounds[j*2])   bounds[j*2]   = p[j];
+        if (p[j]>bounds[j*2+1]) bounds[j*2+1] = p[j];
+      }
+    }
+  }
+
+  void Build(int node, MIPIdType begin, MIPIdType end)
+  {
+    MIPTreeNode &n = this->Tree->Nodes[node];
+    n.Begin = begin;
+    n.End   = end;
+    if (end-begin<=MIP_TREE_LEAF_SIZE) {
+      this->Bounds(begin, end, n.Bounds);
+      n.Max = -HUGE_VAL;
+      for (MIPIdType i=begin; i<end; i++) {
+        if (MIPGreater(this->Items[i].Value, n.Max)) n.Max = this->Items[i].Value;
+      }
+      n.Child[0] = n.Child[1] = -1;
+      return;
+    }
+    double bounds[6];
+    this->Bounds(begin, end, bounds);
+    int axis = 0;
+    for (int j=1; j<3; j++) {
+      if (bounds[j*2+1]-bounds[j*2] > bounds[axis*2+1]-bounds[axis*2]) axis = j;
+    }
+    MIPIdType mid = begin + (end-begin)/2;
+    MIPTreeAxisLess<PT> less = { axis };
+    std::nth_element(this->Items+begin, this->Items+mid, this->Items+end, less);
+    n.Child[0] = node+1;
+    n.Child[1] = node+1+MIPTreeNodeCount(mid-begin);
+#pragma omp task if (end-begin>MIP_TREE_TASK_SIZE)
+    this->Build(n.Child[0], begin, mid);
+#pragma omp task if (end-begin>MIP_TREE_TASK_SIZE)
+    this->Build(n.Child[1], mid, end);
+#pragma omp taskwait
+    const MIPTreeNode &l = this->Tree->Nodes[n.Child[0]];
+    const MIPTreeNode &r = this->Tree->Nodes[n.Child[1]];
+    for (int j=0; j<3; j++) {
+      n.Bounds[j*2]   = std::min(l.Bounds[j*2],   r.Bounds[j*2]);
+      n.Bounds[j*2+1] = std::max(l.Bounds[j*2+1], r.Bounds[j*2+1]);
+    }
+    n.Max = MIPGreater(r.Max, l.Max) ? r.Max : l.Max;
+  }
+};
+//----------------------------------------------------------------------------
+static inline std::vector<float> &MIPTreePoints(MIPTree &tree, const float *)
+{
+  tree.PointsD.clear();
+  return tree.PointsF;
+}
+static inline std::vector<double> &MIPTreePoints(MIPTree &tree, const double *)
+{
+  tree.PointsF.clear();
+  return tree.PointsD;
+}
+//----------------------------------------------------------------------------
+template <typename PT, typename ST>
+void MIPBuildTree(const PT *points, const ST *scalars, int stride,
+  const MIPIdType *ids, MIPIdType N, MIPTree &tree)
+{
+  std::vector<PT> &tpoints = MIPTreePoints(tree, points);
+  tree.Nodes.clear();
+  tpoints.resize(N*3);
+  tree.Values.resize(N);
+  tree.Index.resize(N);
+  if (N==0) {
+    return;
+  }
+  tree.Nodes.resize(MIPTreeNodeCount(N));
+  std::vector< MIPTreeItem<PT> > items(N);
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<N; i++) {
+    MIPIdType id = ids ? ids[i] : i;
+    items[i].P[0]  = points[id*3+0];
+    items[i].P[1]  = points[id*3+1];
+    items[i].P[2]  = points[id*3+2];
+    items[i].Value = scalars ? static_cast<double>(scalars[id*stride]) : 0.0;
+    items[i].Id    = id;
+  }
+  MIPTreeBuilder<PT> builder = { &items[0], &tree };
+#pragma omp parallel
+  {
+#pragma omp single
+    builder.Build(0, 0, N);
+  }
+#pragma omp parallel for schedule(static)
+  for (MIPIdType i=0; i<N; i++) {
+    tpoints[i*3+0] = items[i].P[0];
+    tpoints[i*3+1] = items[i].P[1];
+    tpoints[i*3+2] = items[i].P[2];
+    tree.Values[i] = items[i].Value;
+    tree.Index[i]  = items[i].Id;
+  }
+}
+//----------------------------------------------------------------------------
+// Pixel rectangle covered by a box, false if it cannot be bounded because
+// the box crosses the w=0 plane (the perspective divide is then unbounded).
+// Inside a box that does not cross it x/w is monotonic along every edge, so
+// the corners give the extremes.
+static bool MIPProjectBox(const MIPProjector &P, const double b[6], double rect[4])
+{
+  rect[0] = rect[2] =  HUGE_VAL;
+  rect[1] = rect[3] = -HUGE_VAL;
+  int positive = 0;
+  for (int c=0; c<8; c++) {
+    double x = b[(c&1) ? 1 : 0], y = b[(c&2) ? 3 : 2], z = b[(c&4) ? 5 : 4];
+    double f[2];
+    for (int j=0; j<2; j++) {
+      f[j] = x*P.Row[j][0] + y*P.Row[j][1] + z*P.Row[j][2] + P.Row[j][3];
+    }
+    if (!P.Ortho) {
+      double w = x*P.Row[2][0] + y*P.Row[2][1] + z*P.Row[2][2] + P.Row[2][3];
+      if (w>0.0) positive++;
+      else if (!(w<0.0)) return false;
+      f[0] = f[0]/w + P.Offset[0];
+      f[1] = f[1]/w + P.Offset[1];
+    }
+    rect[0] = std::min(rect[0], f[0]);
+    rect[1] = std::max(rect[1], f[0]);
+    rect[2] = std::min(rect[2], f[1]);
+    rect[3] = std::max(rect[3], f[1]);
+  }
+  return P.Ortho || positive==0 || positive==8;
+}
+//----------------------------------------------------------------------------
+struct MIPTreeLeaf
+{
+  int    Node;
+  bool   Bounded;
+  double Rect[4];
+};
+//----------------------------------------------------------------------------
+// Leaves with the highest values are drawn first so that they occlude as
+// much as possible of what follows.
+struct MIPTreeLeafGreater
+{
+  const MIPTree *Tree;
+  bool operator()(const MIPTreeLeaf &a, const MIPTreeLeaf &b) const
+  {
+    return MIPGreater(this->Tree->Nodes[a.Node].Max, this->Tree->Nodes[b.Node].Max);
+  }
+};
+//----------------------------------------------------------------------------
+// True if no pixel of the footprint is below the max of the leaf. The image
+// only grows while other threads draw, so reading a stale pixel can only
+// make the test fail, never skip a leaf that should be drawn.
+static bool MIPLeafOccluded(const MIPTreeNode &n, const double rect[4],
+  const int size[2], const double *image)
+{
+  // one pixel margin against rounding differences with the point transform
+  int x0 = static_cast<int>(std::max(std::floor(rect[0])-1.0, 0.0));
+  int x1 = static_cast<int>(std::min(std::floor(rect[1])+1.0, size[0]-1.0));
+  int y0 = static_cast<int>(std::max(std::floor(rect[2])-1.0, 0.0));
+  int y1 = static_cast<int>(std::min(std::floor(rect[3])+1.0, size[1]-1.0));
+  // checking must stay cheaper than drawing
+  if (static_cast<double>(x1-x0+1)*(y1-y0+1) > 4.0*(n.End-n.Begin)) {
+    return false;
+  }
+  for (int y=y0; y<=y1; y++) {
+    const double *row = &image[static_cast<MIPIdType>(y)*size[0]];
+    for (int x=x0; x<=x1; x++) {
+      if (MIPGreater(n.Max, MIPLoadPixel(&row[x]))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+//----------------------------------------------------------------------------
+// Leaves are contiguous in tree order and transformed without any gather.
+template <typename Op, typename PT>
+static void MIPProjectLeaf(const MIPProjector &proj, const MIPTreeNode &n,
+  const PT *points, const double *values, int X, int *ix, int *iy, double *image)
+{
+  for (MIPIdType start=n.Begin; start<n.End; start+=MIP_TRANSFORM_BLOCK) {
+    MIPIdType count = std::min<MIPIdType>(MIP_TRANSFORM_BLOCK, n.End-start);
+    MIPTransformPoints(proj, &points[start*3], count, ix, iy);
+    for (MIPIdType j=0; j<count; j++) {
+      if (ix[j]<0) continue;
+      Op::AtomicAccumulate(&image[ix[j] + static_cast<MIPIdType>(iy[j])*X],
+        Op::Value(values[start+j]));
+    }
+  }
+}
+//----------------------------------------------------------------------------
+// Occlusion culling only holds for the max, the other operators only use
+// the frustum culling.
+template <typename Op>
+static void MIPProjectTreeT(const MIPView &view, const MIPTree &tree, double *image,
+  MIPTreeStatistics *stats)
+{
+  const bool occlusion = (Op::Id==MIP_OPERATOR_MAX);
+  MIPProjector proj;
+  MIPInitializeProjector(view, proj);
+  const double X = view.Size[0], Y = view.Size[1];
+  //
+  // frustum culling, the tree is small (N/MIP_TREE_LEAF_SIZE leaves) and
+  // is walked serially
+  //
+  std::vector<MIPTreeLeaf> leaves;
+  int culled = 0;
+  std::vector<int> stack;
+  if (!tree.Nodes.empty()) {
+    stack.push_back(0);
+  }
+  while (!stack.empty()) {
+    const int node = stack.back();
+    stack.pop_back();
+    const MIPTreeNode &n = tree.Nodes[node];
+    MIPTreeLeaf leaf;
+    leaf.Node = node;
+    leaf.Bounded = MIPProjectBox(proj, n.Bounds, leaf.Rect);
+    // a pixel is valid if -1 < f < size, keep one pixel of margin
+    if (leaf.Bounded && (leaf.Rect[1]<-2.0 || leaf.Rect[0]>X+1.0 ||
+                         leaf.Rect[3]<-2.0 || leaf.Rect[2]>Y+1.0)) {
+      culled++;
+      continue;
+    }
+    if (n.Child[0]<0) {
+      leaves.push_back(leaf);
+    }
+    else {
+      stack.push_back(n.Child[1]);
+      stack.push_back(n.Child[0]);
+    }
+  }
+  if (occlusion) {
+    MIPTreeLeafGreater greater = { &tree };
+    std::stable_sort(leaves.begin(), leaves.end(), greater);
+  }
+  //
+  // draw the visible leaves, testing the occlusion of each one just before
+  //
+  MIPIdType projected = 0;
+  int occluded = 0;
+  const MIPIdType nleaves = static_cast<MIPIdType>(leaves.size());
+  const float  *pointsF = tree.PointsF.empty() ? NULL : &tree.PointsF[0];
+  const double *pointsD = tree.PointsD.empty() ? NULL : &tree.PointsD[0];
+  const double *values  = tree.Values.empty()  ? NULL : &tree.Values[0];
+#pragma omp parallel reduction(+:projected,occluded)
+  {
+    int ix[MIP_TRANSFORM_BLOCK], iy[MIP_TRANSFORM_BLOCK];
+#pragma omp for schedule(dynamic,1)
+    for (MIPIdType l=0; l<nleaves; l++) {
+      const MIPTreeNode &n = tree.Nodes[leaves[l].Node];
+      if (occlusion && leaves[l].Bounded && MIPLeafOccluded(n, leaves[l].Rect, view.Size, image)) {
+        occluded++;
+        continue;
+      }
+      if (pointsF) {
+        MIPProjectLeaf<Op>(proj, n, pointsF, values, view.Size[0], ix, iy, image);
+      }
+      else {
+        MIPProjectLeaf<Op>(proj, n, pointsD, values, view.Size[0], ix, iy, image);
+      }
+      projected += n.End-n.Begin;
+    }
+  }
+  if (stats) {
+    stats->ProjectedParticles = projected;
+    stats->FrustumCulledNodes = culled;
+    stats->OccludedLeaves     = occluded;
+  }
+}
+//----------------------------------------------------------------------------
+void MIPProjectTree(const MIPView &view, const MIPTree &tree, double *image,
+  MIPTreeStatistics *stats)
+{
+  MIP_OPERATOR_DISPATCH(view.Operator, MIPProjectTreeT<MIPOp>(view, tree, image, stats));
+}
+//----------------------------------------------------------------------------
+#define MIP_INSTANTIATE_TREE(ST) \
+  template void MIPBuildTree<float, ST>(const float *, const ST *, int, \
+    const MIPIdType *, MIPIdType, MIPTree &); \
+  template void MIPBuildTree<double, ST>(const double *, const ST *, int, \
+    const MIPIdType *, MIPIdType, MIPTree &);
+MIP_FOREACH_SCALAR_TYPE(MIP_INSTANTIATE_TREE)
@@ -0,0 +1,93 @@
+/*=========================================================================
+
+  Program:   pv-MIP
+  Module:    MIPTree.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME MIPTree - k-d tree with per node max scalar for culled projection
+// .SECTION Description
+// A k-d tree over the particles of the local piece, split at the median of
+// the longest axis down to leaves of MIP_TREE_LEAF_SIZE particles. Every
+// node stores the tight bounds of its particles and their max scalar.
+// The particles are stored in tree order so that leaves are read
+// contiguously. The projection walks the tree and skips
+//  - nodes whose bounds project entirely outside the image (frustum culling)
+//  - leaves whose max cannot beat any pixel of their screen footprint
+//    (occlusion culling, effective when zoomed in on dense regions)
+// so the cost follows the number of visible particles. Skipped particles
+// could not have changed the image, the result is identical to
+// MIPProjectPoints.
+//
+// .SECTION See Also
+// MIPProjection vtkMIPPainter
+
+#ifndef __MIPTree_h
+#define __MIPTree_h
+
+#include "MIPProjection.h"
+
+#include <vector>
+
+// Max number of particles in a leaf
+#define MIP_TREE_LEAF_SIZE 1024
+
+//----------------------------------------------------------------------------
+struct MIPTreeNode
+{
+  double    Bounds[6];
+  // max scalar of the particles in the node (-inf if none can be drawn)
+  double    Max;
+  // the particles of the node are Begin..End-1 in tree order
+  MIPIdType Begin, End;
+  // children, -1 for leaves
+  int       Child[2];
+};
+
+//----------------------------------------------------------------------------
+// Description:
+// The particles are copied in tree order, so a leaf is a contiguous range
+// of Points/Values/Index. Points are kept in their input precision, only
+// one of PointsF/PointsD is used.
+struct MIPTree
+{
+  std::vector<MIPTreeNode> Nodes;
+  std::vector<float>       PointsF;
+  std::vector<double>      PointsD;
+  std::vector<double>      Values;
+  // id of the particles in the input
+  std::vector<MIPIdType>   Index;
+};
+
+//----------------------------------------------------------------------------
+// Description:
+// Counters filled by MIPProjectTree.
+struct MIPTreeStatistics
+{
+  MIPIdType ProjectedParticles;
+  int       FrustumCulledNodes;
+  int       OccludedLeaves;
+};
+
+// Description:
+// Build the tree over the N particles ids[0..N-1], or over particles 0..N-1
+// if ids is NULL. The scalars are read like in MIPProjectPoints.
+// Instantiated for float/double points and all types of MIP_FOREACH_SCALAR_TYPE.
+template <typename PT, typename ST>
+void MIPBuildTree(const PT *points, const ST *scalars, int stride,
+  const MIPIdType *ids, MIPIdType N, MIPTree &tree);
+
+// Description:
+// Project the particles of the tree into the image, see MIPProjectPoints.
+// Leaves are only occlusion culled for the max operator.
+void MIPProjectTree(const MIPView &view, const MIPTree &tree, double *image,
+  MIPTreeStatistics *stats=NULL);
+
+#endif
@@ -0,0 +1,503 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMIPCompositor.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkMIPCompositor.h"
+
+#include "vtkCommunicator.h"
+#include "vtkMultiProcessController.h"
+#include "vtkObjectFactory.h"
+#if defined(USE_MPI) || defined(VTK_USE_MPI)
+#include "vtkMPICommunicator.h"
+#include "vtkMPI.h"
+#endif
+//
+#include "MIPOperator.h"
+#include "MIPPick.h"
+#include "MIPProjection.h"
+#include "MIPReduction.h"
+#include "MIPSparse.h"
+
+#include <algorithm>
+#include <string.h>
+
+#define MIP_SPARSE_SIZE_TAG 5701
+#define MIP_SPARSE_DATA_TAG 5702
+#define MIP_SWAP_FOLD_TAG   5703
+#define MIP_SWAP_TAG        5704
+#define MIP_PICK_ROWS_TAG   5705
+#define MIP_PICK_DATA_TAG   5706
+
+//----------------------------------------------------------------------------
+// The non blocking reductions of the bands in flight
+class vtkMIPCompositorRequests
+{
+public:
+#if (defined(USE_MPI) || defined(VTK_USE_MPI)) && MPI_VERSION>=3
+  std::vector<MPI_Request> Requests;
+#endif
+};
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkMIPCompositor);
+vtkCxxSetObjectMacro(vtkMIPCompositor, Controller, vtkMultiProcessController);
+//----------------------------------------------------------------------------
+vtkMIPCompositor::vtkMIPCompositor()
+{
+  this->Controller      = NULL;
+  this->CompositingMode = REDUCE;
+  this->Precision       = DOUBLE_PRECISION;
+  this->Operator        = MIP_OPERATOR_MAX;
+  this->OwnedPixels[0]  = 0;
+  this->OwnedPixels[1]  = 0;
+  this->Distributed     = false;
+  this->BytesSent       = 0;
+  this->BandLocal       = NULL;
+  this->BandResult      = NULL;
+  this->BandSize[0]     = 0;
+  this->BandSize[1]     = 0;
+  this->BandRow         = 0;
+  this->BandsOverlap    = 0;
+  this->BandRequests    = new vtkMIPCompositorRequests;
+}
+//----------------------------------------------------------------------------
+vtkMIPCompositor::~vtkMIPCompositor()
+{
+  this->SetController(NULL);
+  delete this->BandRequests;
+}
+//----------------------------------------------------------------------------
+void vtkMIPCompositor::Composite(const double *local, double *result, int X, int Y)
+{
+  vtkIdType npixels = static_cast<vtkIdType>(X)*Y;
+  int rank = this->Controller ? this->Controller->GetLocalProcessId() : 0;
+  this->Distributed    = false;
+  this->OwnedPixels[0] = 0;
+  this->OwnedPixels[1] = (rank==0) ? npixels : 0;
+  if (!this->Controller || this->Controller->GetNumberOfProcesses()<2) {
+    memcpy(result, local, npixels*sizeof(double));
+    return;
+  }
+  switch (this->CompositingMode) {
+    case SPARSE:
+      this->CompositeSparse(local, result, X, Y);
+      break;
+    case BINARY_SWAP:
+      this->CompositeBinarySwap(local, result, npixels);
+      break;
+    default:
+      this->CompositeReduce(local, result, npixels);
+  }
+}
+//----------------------------------------------------------------------------
+int vtkMIPCompositor::GetReduceOperation()
+{
+  switch (this->Operator) {
+    case MIP_OPERATOR_MIN:
+      return vtkCommunicator::MIN_OP;
+    case MIP_OPERATOR_SUM:
+    case MIP_OPERATOR_MEAN:
+    case MIP_OPERATOR_COUNT:
+      return vtkCommunicator::SUM_OP;
+    default:
+      return vtkCommunicator::MAX_OP;
+  }
+}
+//----------------------------------------------------------------------------
+void vtkMIPCompositor::CompositeReduce(const double *local, double *result, vtkIdType npixels)
+{
+  const int operation = this->GetReduceOperation();
+  int precision = this->Precision;
+  if (precision==QUANTIZED_16 && this->Operator!=MIP_OPERATOR_MAX) {
+    // quantized values cannot be summed, and 0 (empty) would win a min
+    precision = FLOAT_PRECISION;
+  }
+  switch (precision) {
+    case FLOAT_PRECISION:
+    {
+      this->LocalFloat.resize(npixels);
+      this->ResultFloat.resize(npixels);
+      MIPEncodeFloat(local, npixels, &this->LocalFloat[0]);
+      this->BytesSent += npixels*sizeof(float);
+      this->Controller->Reduce(&this->LocalFloat[0], &this->ResultFloat[0], 
+        npixels, operation, 0);
+      if (this->Controller->GetLocalProcessId()==0) {
+        MIPDecodeFloat(&this->ResultFloat[0], npixels, result);
+      }
+      break;
+    }
+    case QUANTIZED_16:
+    {
+      // agree on the range, min is sent negated so one MAX_OP does both
+      double range[2], globalRange[2];
+      MIPImageRange(local, npixels, range);
+      range[0] = -range[0];
+      this->Controller->AllReduce(range, globalRange, 2, vtkCommunicator::MAX_OP);
+      this->BytesSent += sizeof(range);
+      globalRange[0] = -globalRange[0];
+      if (globalRange[0]>globalRange[1]) {
+        // nothing was drawn anywhere
+        MIPClearImage(result, npixels);
+        break;
+      }
+      this->LocalShort.resize(npixels);
+      this->ResultShort.resize(npixels);
+      MIPQuantize16(local, npixels, globalRange, &this->LocalShort[0]);
+      this->BytesSent += npixels*sizeof(unsigned short);
+      this->Controller->Reduce(&this->LocalShort[0], &this->ResultShort[0], 
+        npixels, vtkCommunicator::MAX_OP, 0);
+      if (this->Controller->GetLocalProcessId()==0) {
+        MIPDequantize16(&this->ResultShort[0], npixels, globalRange, result);
+      }
+      break;
+    }
+    default:
+      this->BytesSent += npixels*sizeof(double);
+      this->Controller->Reduce(local, result, npixels, operation, 0);
+  }
+}
+//----------------------------------------------------------------------------
+// Binomial tree : at each step half of the remaining processes send their
+// (sparse) image to a partner which merges it into its own. Only the
+// bounding rectangle of the accumulated image is encoded, and the encoding
+// falls back to the dense rectangle when that is smaller.
+// The values are always sent in double precision.
+void vtkMIPCompositor::CompositeSparse(const double *local, double *result, int X, int Y)
+{
+  const int rank = this->Controller->GetLocalProcessId();
+  const int P    = this->Controller->GetNumberOfProcesses();
+  const double empty = MIPOperatorEmpty(this->Operator);
+  memcpy(result, local, static_cast<size_t>(X)*Y*sizeof(double));
+  MIPRect rect;
+  MIPImageBounds(result, X, Y, rect, empty);
+  for (int step=1; step<P; step*=2) {
+    if (rank % (2*step) == step) {
+      MIPEncodeSparse(result, X, rect, this->SendBuffer, empty);
+      vtkIdType size = static_cast<vtkIdType>(this->SendBuffer.size());
+      this->Controller->Send(&size, 1, rank-step, MIP_SPARSE_SIZE_TAG);
+      this->Controller->Send(&this->SendBuffer[0], size, rank-step, MIP_SPARSE_DATA_TAG);
+      this->BytesSent += sizeof(size) + size;
+      break;
+    }
+    else if (rank % (2*step) == 0 && rank+step<P) {
+      vtkIdType size = 0;
+      this->Controller->Receive(&size, 1, rank+step, MIP_SPARSE_SIZE_TAG);
+      this->ReceiveBuffer.resize(size);
+      this->Controller->Receive(&this->ReceiveBuffer[0], size, rank+step, MIP_SPARSE_DATA_TAG);
+      MIPRect received;
+      MIPMergeSparse(&this->ReceiveBuffer[0], result, X, received, this->Operator);
+      MIPRectUnion(rect, received, rect);
+    }
+  }
+}
+//----------------------------------------------------------------------------
+void vtkMIPCompositor::GetSwapRange(int rank, int P, vtkIdType npixels, vtkIdType range[2])
+{
+  int P2 = 1;
+  while (P2*2<=P) P2 *= 2;
+  range[0] = 0;
+  range[1] = (rank<P2) ? npixels : 0;
+  // the upper half goes to the process with the bit set, so strips are in rank order
+  for (int bit=P2/2; bit>0 && rank<P2; bit/=2) {
+    vtkIdType mid = range[0] + (range[1]-range[0])/2;
+    if (rank & bit) range[0] = mid;
+    else            range[1] = mid;
+  }
+}
+//----------------------------------------------------------------------------
+void vtkMIPCompositor::Exchange(const double *send, vtkIdType nsend,
+  double *receive, vtkIdType nreceive, int partner, int tag)
+{
+  this->BytesSent += nsend*sizeof(double);
+#if defined(USE_MPI) || defined(VTK_USE_MPI)
+  vtkMPICommunicator *mpi = 
+    vtkMPICommunicator::SafeDownCast(this->Controller->GetCommunicator());
+  if (mpi) {
+    vtkMPICommunicator::Request request;
+    mpi->NoBlockSend(send, static_cast<int>(nsend), partner, tag, request);
+    mpi->Receive(receive, nreceive, partner, tag);
+    request.Wait();
+    return;
+  }
+#endif
+  // blocking fallback, order the calls so the pair cannot deadlock
+  if (this->Controller->GetLocalProcessId()<partner) {
+    this->Controller->Send(send, nsend, partner, tag);
+    this->Controller->Receive(receive, nreceive, partner, tag);
+  }
+  else {
+    this->Controller->Receive(receive, nreceive, partner, tag);
+    this->Controller->Send(send, nsend, partner, tag);
+  }
+}
+//----------------------------------------------------------------------------
+// Binary swap over the largest power of two P2 <= P. The processes beyond P2
+// first fold their image into a partner. Then at each step every process
+// sends the half of its current region it gives up to its partner and merges
+// the partner's copy of the half it keeps. The values are sent in double
+// precision.
+void vtkMIPCompositor::CompositeBinarySwap(const double *local, double *result, vtkIdType npixels)
+{
+  const int rank = this->Controller->GetLocalProcessId();
+  const int P    = this->Controller->GetNumberOfProcesses();
+  int P2 = 1;
+  while (P2*2<=P) P2 *= 2;
+  memcpy(result, local, npixels*sizeof(double));
+  this->Distributed = true;
+  //
+  // fold the extra processes
+  //
+  if (rank>=P2) {
+    this->Controller->Send(result, npixels, rank-P2, MIP_SWAP_FOLD_TAG);
+    this->BytesSent += npixels*sizeof(double);
+    this->OwnedPixels[0] = this->OwnedPixels[1] = 0;
+    return;
+  }
+  if (rank+P2<P) {
+    this->SwapBuffer.resize(npixels);
+    this->Controller->Receive(&this->SwapBuffer[0], npixels, rank+P2, MIP_SWAP_FOLD_TAG);
+    MIPMergeImages(&this->SwapBuffer[0], npixels, this->Operator, result);
+  }
+  //
+  // swap halves
+  //
+  vtkIdType lo = 0, hi = npixels;
+  for (int bit=P2/2; bit>0; bit/=2) {
+    int partner = rank ^ bit;
+    vtkIdType mid = lo + (hi-lo)/2;
+    vtkIdType keep[2], give[2];
+    if (rank & bit) {
+      keep[0] = mid; keep[1] = hi;
+      give[0] = lo;  give[1] = mid;
+    }
+    else {
+      keep[0] = lo;  keep[1] = mid;
+      give[0] = mid; give[1] = hi;
+    }
+    vtkIdType nkeep = keep[1]-keep[0];
+    this->SwapBuffer.resize(nkeep>0 ? nkeep : 1);
+    this->Exchange(&result[give[0]], give[1]-give[0],
+      &this->SwapBuffer[0], nkeep, partner, MIP_SWAP_TAG);
+    MIPMergeImages(&this->SwapBuffer[0], nkeep, this->Operator, &result[keep[0]]);
+    lo = keep[0];
+    hi = keep[1];
+  }
+  this->OwnedPixels[0] = lo;
+  this->OwnedPixels[1] = hi;
+}
+//----------------------------------------------------------------------------
+void vtkMIPCompositor::GatherColours(const unsigned char *owned, unsigned char *rgb,
+  int X, int Y, int components)
+{
+  if (!this->Distributed) {
+    return;
+  }
+  const int rank = this->Controller->GetLocalProcessId();
+  const int P    = this->Controller->GetNumberOfProcesses();
+  const vtkIdType npixels = static_cast<vtkIdType>(X)*Y;
+  std::vector<vtkIdType> lengths(P), offsets(P);
+  for (int p=0; p<P; p++) {
+    vtkIdType range[2];
+    vtkMIPCompositor::GetSwapRange(p, P, npixels, range);
+    lengths[p] = (range[1]-range[0])*components;
+    offsets[p] = range[0]*components;
+  }
+  // the send buffer must not overlap the receive buffer on process 0
+  vtkIdType nsend = lengths[rank];
+  this->StripBuffer.resize(nsend>0 ? nsend : 1);
+  if (nsend>0) {
+    memcpy(&this->StripBuffer[0], owned, nsend);
+  }
+  this->BytesSent += nsend;
+  this->Controller->GatherV(&this->StripBuffer[0], rgb, nsend,
+    &lengths[0], &offsets[0], 0);
+}
+//----------------------------------------------------------------------------
+// Same binomial tree as CompositeSparse. The rows holding winners are
+// found first and only that band of rows is sent, records are plain old
+// data and travel as bytes.
+void vtkMIPCompositor::CompositePickRecords(MIPPickRecord *records, int X, int Y)
+{
+  if (!this->Controller || this->Controller->GetNumberOfProcesses()<2) {
+    return;
+  }
+  const int rank = this->Controller->GetLocalProcessId();
+  const int P    = this->Controller->GetNumberOfProcesses();
+  const size_t rowbytes = static_cast<size_t>(X)*sizeof(MIPPickRecord);
+  int rows[2] = { Y, 0 };
+  for (int y=0; y<Y; y++) {
+    const MIPPickRecord *row = &records[static_cast<vtkIdType>(y)*X];
+    for (int x=0; x<X; x++) {
+      if (row[x].Id>=0) {
+        rows[0] = std::min(rows[0], y);
+        rows[1] = y+1;
+        break;
+      }
+    }
+  }
+  for (int step=1; step<P; step*=2) {
+    if (rank % (2*step) == step) {
+      this->Controller->Send(rows, 2, rank-step, MIP_PICK_ROWS_TAG);
+      this->BytesSent += sizeof(rows);
+      if (rows[0]<rows[1]) {
+        this->Controller->Send(
+          reinterpret_cast<const char*>(&records[static_cast<vtkIdType>(rows[0])*X]),
+          static_cast<vtkIdType>((rows[1]-rows[0])*rowbytes), rank-step, MIP_PICK_DATA_TAG);
+        this->BytesSent += (rows[1]-rows[0])*rowbytes;
+      }
+      break;
+    }
+    else if (rank % (2*step) == 0 && rank+step<P) {
+      int received[2];
+      this->Controller->Receive(received, 2, rank+step, MIP_PICK_ROWS_TAG);
+      if (received[0]>=received[1]) {
+        continue;
+      }
+      // operator new storage is aligned for any record
+      this->ReceiveBuffer.resize((received[1]-received[0])*rowbytes);
+      this->Controller->Receive(&this->ReceiveBuffer[0],
+        static_cast<vtkIdType>(this->ReceiveBuffer.size()), rank+step, MIP_PICK_DATA_TAG);
+      MIPMergePickRecords(reinterpret_cast<const MIPPickRecord*>(&this->ReceiveBuffer[0]),
+        static_cast<vtkIdType>(received[1]-received[0])*X, this->Operator,
+        &records[static_cast<vtkIdType>(received[0])*X]);
+      rows[0] = std::min(rows[0], received[0]);
+      rows[1] = std::max(rows[1], received[1]);
+    }
+  }
+}
+//----------------------------------------------------------------------------
+bool vtkMIPCompositor::BandsAsFloat()
+{
+  // quantizing needs the global range first, float is used instead
+  return this->Precision!=DOUBLE_PRECISION;
+}
+//----------------------------------------------------------------------------
+void vtkMIPCompositor::BeginBands(const double *local, double *result, int X, int Y)
+{
+  int rank = this->Controller ? this->Controller->GetLocalProcessId() : 0;
+  vtkIdType npixels = static_cast<vtkIdType>(X)*Y;
+  this->Distributed    = false;
+  this->OwnedPixels[0] = 0;
+  this->OwnedPixels[1] = (rank==0) ? npixels : 0;
+  this->BandLocal   = local;
+  this->BandResult  = result;
+  this->BandSize[0] = X;
+  this->BandSize[1] = Y;
+  this->BandRow     = 0;
+  const bool parallel = this->Controller && this->Controller->GetNumberOfProcesses()>1;
+  if (parallel && this->BandsAsFloat()) {
+    this->LocalFloat.resize(npixels);
+    this->ResultFloat.resize(rank==0 ? npixels : 1);
+  }
+  // bands reduced during the projection are sent while the other OpenMP
+  // threads are still drawing. The bands are the same either way, so
+  // processes may differ in this
+  this->BandsOverlap = 1;
+#if defined(USE_MPI) || defined(VTK_USE_MPI)
+  if (parallel) {
+    int level = MPI_THREAD_SINGLE;
+    MPI_Query_thread(&level);
+    this->BandsOverlap = (level>=MPI_THREAD_FUNNELED);
+  }
+#endif
+}
+//----------------------------------------------------------------------------
+void vtkMIPCompositor::BandCallback(int y0, int y1, void *compositor)
+{
+  static_cast<vtkMIPCompositor*>(compositor)->CompositeBand(y0, y1);
+}
+//----------------------------------------------------------------------------
+void vtkMIPCompositor::CompositeBand(int y0, int y1)
+{
+  const int X = this->BandSize[0];
+  const vtkIdType first = static_cast<vtkIdType>(y0)*X;
+  const vtkIdType n     = static_cast<vtkIdType>(y1-y0)*X;
+  this->BandRow = y1;
+  if (n<=0) {
+    return;
+  }
+  if (!this->Controller || this->Controller->GetNumberOfProcesses()<2) {
+    memcpy(&this->BandResult[first], &this->BandLocal[first], n*sizeof(double));
+    return;
+  }
+  const bool asFloat = this->BandsAsFloat();
+  const bool root = (this->Controller->GetLocalProcessId()==0);
+  if (asFloat) {
+    MIPEncodeFloat(&this->BandLocal[first], n, &this->LocalFloat[first]);
+  }
+  this->BytesSent += n*(asFloat ? sizeof(float) : sizeof(double));
+#if (defined(USE_MPI) || defined(VTK_USE_MPI)) && MPI_VERSION>=3
+  vtkMPICommunicator *mpi =
+    vtkMPICommunicator::SafeDownCast(this->Controller->GetCommunicator());
+  if (mpi) {
+    MPI_Op op = MPI_MAX;
+    switch (this->GetReduceOperation()) {
+      case vtkCommunicator::MIN_OP: op = MPI_MIN; break;
+      case vtkCommunicator::SUM_OP: op = MPI_SUM; break;
+      default: break;
+    }
+    MPI_Request request;
+    if (asFloat) {
+      MPI_Ireduce(&this->LocalFloat[first], root ? &this->ResultFloat[first] : NULL,
+        static_cast<int>(n), MPI_FLOAT, op, 0, *mpi->GetMPIComm()->GetHandle(), &request);
+    }
+    else {
+      MPI_Ireduce(&this->BandLocal[first], root ? &this->BandResult[first] : NULL,
+        static_cast<int>(n), MPI_DOUBLE, op, 0, *mpi->GetMPIComm()->GetHandle(), &request);
+    }
+    this->BandRequests->Requests.push_back(request);
+    return;
+  }
+#endif
+  // no non blocking collectives, reduce the band right away
+  const int operation = this->GetReduceOperation();
+  if (asFloat) {
+    this->Controller->Reduce(&this->LocalFloat[first],
+      root ? &this->ResultFloat[first] : &this->ResultFloat[0], n, operation, 0);
+  }
+  else {
+    this->Controller->Reduce(&this->BandLocal[first],
+      root ? &this->BandResult[first] : &this->BandResult[0], n, operation, 0);
+  }
+}
+//----------------------------------------------------------------------------
+void vtkMIPCompositor::EndBands()
+{
+  // the same bands on every process, whatever they drew
+  while (this->BandRow<this->BandSize[1]) {
+    this->CompositeBand(this->BandRow,
+      std::min(this->BandRow+MIP_TILE_SIZE, this->BandSize[1]));
+  }
+#if (defined(USE_MPI) || defined(VTK_USE_MPI)) && MPI_VERSION>=3
+  std::vector<MPI_Request> &requests = this->BandRequests->Requests;
+  if (!requests.empty()) {
+    MPI_Waitall(static_cast<int>(requests.size()), &requests[0], MPI_STATUSES_IGNORE);
+    requests.clear();
+  }
+#endif
+  if (this->Controller && this->Controller->GetNumberOfProcesses()>1 &&
+      this->BandsAsFloat() && this->Controller->GetLocalProcessId()==0) {
+    MIPDecodeFloat(&this->ResultFloat[0],
+      static_cast<vtkIdType>(this->BandSize[0])*this->BandSize[1], this->BandResult);
+  }
+  this->BandLocal  = NULL;
+  this->BandResult = NULL;
+}
+//----------------------------------------------------------------------------
+void vtkMIPCompositor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "CompositingMode: " << this->CompositingMode << "\n";
+  os << indent << "Precision: " << this->Precision << "\n";
+  os << indent << "Operator: " << this->Operator << "\n";
+  os << indent << "Controller: " << this->Controller << "\n";
+}
@@ -0,0 +1,216 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMIPCompositor.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkMIPCompositor - max compositing of MIP images across processes
+// .SECTION Description
+// Each process projects its own piece of the particles into a full size
+// scalar image, vtkMIPCompositor combines them with a max operator so that
+// the root process ends up with the MIP of the whole dataset. Images
+// accumulated with another operator (see MIPOperator) are combined with
+// the matching vtkCommunicator operation, MIN_OP for min images and SUM_OP
+// for sums and counts.
+// The images can be sent at reduced precision (see MIPReduction), max
+// commutes with the (monotone) encodings so only the precision of the
+// final values is affected.
+// In SPARSE mode the images are combined along a binomial tree and each
+// message only carries the occupied pixels of the sender (see MIPSparse),
+// so the traffic follows the projected footprint rather than the window.
+// In BINARY_SWAP mode the image is reduce-scattered : after log2(P) pairwise
+// exchanges of halves every process holds the final values of one strip of
+// pixels (see GetOwnedPixels), which it colour maps itself before the RGB
+// strips are gathered on process 0 (see GatherColours). Both the reduction
+// and the colour mapping then scale with the number of processes.
+// In PIPELINED mode the image is reduced in bands of rows, each with a non
+// blocking MPI_Ireduce started as soon as the band is drawn (see
+// BeginBands), so the reduction overlaps the rest of the projection.
+// The bands are then sent from inside the projection's OpenMP region, which
+// MPI only allows from MPI_THREAD_FUNNELED up. At a lower thread level the
+// bands are all reduced after the projection (see GetBandsOverlap).
+// Images composited with Composite are reduced as in REDUCE mode.
+//
+// .SECTION See Also
+// vtkMIPPainter MIPReduction
+
+#ifndef __vtkMIPCompositor_h
+#define __vtkMIPCompositor_h
+
+#include "vtkObject.h"
+
+#include <vector> // needed for our buffers
+
+class vtkMultiProcessController;
+class vtkMIPCompositorRequests;
+struct MIPPickRecord;
+
+class VTK_EXPORT vtkMIPCompositor : public vtkObject
+{
+public:
+  static vtkMIPCompositor* New();
+  vtkTypeMacro(vtkMIPCompositor, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+//BTX
+  enum
+    {
+    REDUCE      = 0,
+    SPARSE      = 1,
+    BINARY_SWAP = 2,
+    PIPELINED   = 3
+    };
+
+  enum
+    {
+    DOUBLE_PRECISION = 0,
+    FLOAT_PRECISION  = 1,
+    QUANTIZED_16     = 2
+    };
+//ETX
+
+  // Description:
+  // How images are combined, REDUCE (a dense Reduce to process 0) by default.
+  vtkSetClampMacro(CompositingMode, int, REDUCE, PIPELINED);
+  vtkGetMacro(CompositingMode, int);
+
+  // Description:
+  // Operator the images were accumulated with, one of the MIP_OPERATOR_*
+  // of MIPOperator.h, MIP_OPERATOR_MAX (0) by default. Empty pixels of the
+  // local images must hold the empty value of the operator, and so do
+  // those of the result.
+  vtkSetMacro(Operator, int);
+  vtkGetMacro(Operator, int);
+
+  // Description:
+  // Encoding used to send images between processes, DOUBLE_PRECISION
+  // by default. QUANTIZED_16 quantizes over the global range of the image,
+  // which costs one extra small collective. It is only used for max images,
+  // the other operators fall back to FLOAT_PRECISION.
+  vtkSetClampMacro(Precision, int, DOUBLE_PRECISION, QUANTIZED_16);
+  vtkGetMacro(Precision, int);
+
+  // Description:
+  // Set/Get the controller used for the reduction.
+  virtual void SetController(vtkMultiProcessController* controller);
+  vtkGetObjectMacro(Controller, vtkMultiProcessController);
+
+  // Description:
+  // Reduce the X*Y image local from all processes into result on
+  // process 0. This is a collective call.
+  void Composite(const double *local, double *result, int X, int Y);
+
+  // Description:
+  // Banded reduction of the X*Y image local into result on process 0, for
+  // the PIPELINED mode. CompositeBand(y0, y1) starts the reduction of rows
+  // [y0, y1) of local, which must not change afterwards. Bands must come
+  // in order and be the same on all processes, rows of MIP_TILE_SIZE as
+  // given by MIPView::BandCallback (BandCallback can be used directly with
+  // this compositor as its data). EndBands starts the bands that were not
+  // reported (all of them on a process without particles) and waits for
+  // all the reductions. Uses blocking reductions without MPI-3.
+  // These are collective calls.
+  void BeginBands(const double *local, double *result, int X, int Y);
+  void CompositeBand(int y0, int y1);
+  void EndBands();
+  static void BandCallback(int y0, int y1, void *compositor);
+
+  // Description:
+  // After BeginBands, whether CompositeBand may be called while the
+  // projection runs (from the master thread of its parallel region). False
+  // when MPI was initialized below MPI_THREAD_FUNNELED (as ParaView does),
+  // the bands must then be left to EndBands.
+  vtkGetMacro(BandsOverlap, int);
+
+  // Description:
+  // After Composite, the range [first, last) of pixels for which this
+  // process holds the final values. This is the whole image on process 0
+  // and nothing elsewhere, except in BINARY_SWAP mode.
+  vtkGetVector2Macro(OwnedPixels, vtkIdType);
+
+  // Description:
+  // Collect the colours of the owned pixels (components bytes per pixel)
+  // of all processes into the X*Y image rgb on process 0. owned may point
+  // into rgb. Does nothing unless the last Composite distributed the image.
+  // This is a collective call.
+  void GatherColours(const unsigned char *owned, unsigned char *rgb,
+    int X, int Y, int components);
+
+  // Description:
+  // Merge the pick records (see MIPPick) of the X*Y images of all processes
+  // into records on process 0, keeping the winner of every pixel for
+  // Operator (max or min). This is a paired value/location reduction done
+  // along a binomial tree, each message only carries the rows of the
+  // sender that hold a winner. This is a collective call.
+  void CompositePickRecords(MIPPickRecord *records, int X, int Y);
+
+  // Description:
+  // Bytes this process sent (or contributed to collectives) since the
+  // last ResetBytesSent, for the frame statistics of the painter.
+  vtkGetMacro(BytesSent, vtkIdType);
+  void ResetBytesSent() { this->BytesSent = 0; }
+
+//BTX
+protected:
+   vtkMIPCompositor();
+  ~vtkMIPCompositor();
+
+  // Description:
+  // The compositing modes.
+  void CompositeReduce(const double *local, double *result, vtkIdType npixels);
+  void CompositeSparse(const double *local, double *result, int X, int Y);
+  void CompositeBinarySwap(const double *local, double *result, vtkIdType npixels);
+
+  // Description:
+  // Send/receive with the same partner at the same time.
+  void Exchange(const double *send, vtkIdType nsend,
+    double *receive, vtkIdType nreceive, int partner, int tag);
+
+  // Description:
+  // Pixels owned by rank after a binary swap over P processes.
+  static void GetSwapRange(int rank, int P, vtkIdType npixels, vtkIdType range[2]);
+
+  // Description:
+  // The vtkCommunicator operation matching Operator.
+  int GetReduceOperation();
+
+  // Description:
+  // Whether bands are sent as floats, and the band state : images, size
+  // and next row to reduce, pending requests.
+  bool BandsAsFloat();
+  const double              *BandLocal;
+  double                    *BandResult;
+  int                        BandSize[2];
+  int                        BandRow;
+  int                        BandsOverlap;
+  vtkMIPCompositorRequests  *BandRequests;
+
+  vtkMultiProcessController *Controller;
+  int                        CompositingMode;
+  int                        Precision;
+  int                        Operator;
+  vtkIdType                  OwnedPixels[2];
+  bool                       Distributed;
+  vtkIdType                  BytesSent;
+  // encoding buffers kept between frames
+  std::vector<float>          LocalFloat, ResultFloat;
+  std::vector<unsigned short> LocalShort, ResultShort;
+  std::vector<char>           SendBuffer, ReceiveBuffer;
+  std::vector<double>         SwapBuffer;
+  std::vector<unsigned char>  StripBuffer;
+
+private:
+  vtkMIPCompositor(const vtkMIPCompositor&); // Not implemented.
+  void operator=(const vtkMIPCompositor&); // Not implemented.
+//ETX
+};
+
+#endif
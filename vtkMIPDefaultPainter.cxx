@@ -48,6 +48,8 @@ void vtkMIPDefaultPainter::BuildPainterChain()
 {
   // Override painters we don't want.
   this->SetDisplayListPainter(NULL);
+  // the MIP painter draws all the blocks of composite inputs itself, into
+  // one image, rather than being called once per block
   this->SetCompositePainter(NULL);
   this->SetCoincidentTopologyResolutionPainter(NULL);
   this->SetRepresentationPainter(NULL);
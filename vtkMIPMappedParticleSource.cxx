@@ -0,0 +1,209 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMIPMappedParticleSource.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkMIPMappedParticleSource.h"
+
+#include "vtkByteSwap.h"
+#include "vtkFloatArray.h"
+#include "vtkInformation.h"
+#include "vtkInformationObjectBaseKey.h"
+#include "vtkInformationVector.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSmartPointer.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkVersionMacros.h"
+#include <vtksys/SystemTools.hxx>
+//
+#include "MIPMappedFile.h"
+
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------
+// A mapping as a reference counted object. The arrays pointing into it
+// hold it in their information, so it outlives a remap or the source.
+class vtkMIPMappedFile : public vtkObject
+{
+public:
+  static vtkMIPMappedFile* New();
+  vtkTypeMacro(vtkMIPMappedFile, vtkObject);
+
+  MIPMappedFile File;
+  std::string   FileName;
+  long int      FileTime;
+
+protected:
+   vtkMIPMappedFile() : FileTime(0) {}
+  ~vtkMIPMappedFile() { MIPUnmapFile(this->File); }
+
+private:
+  vtkMIPMappedFile(const vtkMIPMappedFile&); // Not implemented.
+  void operator=(const vtkMIPMappedFile&); // Not implemented.
+};
+vtkStandardNewMacro(vtkMIPMappedFile);
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkMIPMappedParticleSource);
+vtkInformationKeyMacro(vtkMIPMappedParticleSource, MAPPED_FILE, ObjectBase);
+//----------------------------------------------------------------------------
+vtkMIPMappedParticleSource::vtkMIPMappedParticleSource()
+{
+  this->FileName    = NULL;
+  this->HeaderBytes = 0;
+  this->ScalarNames = NULL;
+  this->Mapping     = NULL;
+  this->SetNumberOfInputPorts(0);
+}
+//----------------------------------------------------------------------------
+vtkMIPMappedParticleSource::~vtkMIPMappedParticleSource()
+{
+  this->SetFileName(NULL);
+  this->SetScalarNames(NULL);
+  if (this->Mapping) {
+    this->Mapping->Delete();
+  }
+}
+//----------------------------------------------------------------------------
+// n tuples of the mapping starting at data, as a float array
+static vtkSmartPointer<vtkFloatArray> vtkMIPMappedParticleSource_Wrap(
+  vtkMIPMappedFile *mapping, char *data, int components, vtkIdType n, const char *name)
+{
+  vtkSmartPointer<vtkFloatArray> array = vtkSmartPointer<vtkFloatArray>::New();
+  array->SetNumberOfComponents(components);
+  array->SetName(name);
+#ifdef VTK_WORDS_BIGENDIAN
+  array->SetNumberOfTuples(n);
+  memcpy(array->GetPointer(0), data, n*components*sizeof(float));
+  vtkByteSwap::Swap4LERange(array->GetPointer(0), n*components);
+  (void)mapping;
+#else
+  // save=1, the array never frees the mapping itself
+  array->SetArray(reinterpret_cast<float*>(data), n*components, 1);
+  array->GetInformation()->Set(vtkMIPMappedParticleSource::MAPPED_FILE(), mapping);
+#endif
+  return array;
+}
+//----------------------------------------------------------------------------
+int vtkMIPMappedParticleSource::RequestInformation(vtkInformation*,
+  vtkInformationVector**, vtkInformationVector* outputVector)
+{
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  // any number of pieces, each process maps all and wraps its own slice
+#if VTK_MAJOR_VERSION>=7
+  outInfo->Set(CAN_HANDLE_PIECE_REQUEST(), 1);
+#else
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::MAXIMUM_NUMBER_OF_PIECES(), -1);
+#endif
+  return 1;
+}
+//----------------------------------------------------------------------------
+int vtkMIPMappedParticleSource::RequestData(vtkInformation*,
+  vtkInformationVector**, vtkInformationVector* outputVector)
+{
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  vtkPolyData *output = vtkPolyData::SafeDownCast(outInfo->Get(vtkDataObject::DATA_OBJECT()));
+  int piece  = outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER());
+  int pieces = outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES());
+  if (pieces<1) {
+    piece  = 0;
+    pieces = 1;
+  }
+  if (!this->FileName || !this->FileName[0]) {
+    vtkErrorMacro(<< "No FileName set");
+    return 0;
+  }
+  if (this->HeaderBytes<0 || this->HeaderBytes%4!=0) {
+    vtkErrorMacro(<< "HeaderBytes must be a non negative multiple of 4");
+    return 0;
+  }
+  //
+  // (re)map when the file changed, arrays of the previous output keep the
+  // old mapping alive as long as they exist
+  //
+  long int fileTime = vtksys::SystemTools::ModifiedTime(this->FileName);
+  if (!this->Mapping || this->Mapping->FileName!=this->FileName ||
+      this->Mapping->FileTime!=fileTime) {
+    vtkMIPMappedFile *mapping = vtkMIPMappedFile::New();
+    if (!MIPMapFile(this->FileName, mapping->File)) {
+      vtkErrorMacro(<< "Cannot map " << this->FileName);
+      mapping->Delete();
+      return 0;
+    }
+    mapping->FileName = this->FileName;
+    mapping->FileTime = fileTime;
+    if (this->Mapping) {
+      this->Mapping->Delete();
+    }
+    this->Mapping = mapping;
+  }
+  const MIPMappedFile &file = this->Mapping->File;
+  //
+  // the positions, then one array per scalar name
+  //
+  std::vector<std::string> names;
+  std::string list(this->ScalarNames ? this->ScalarNames : "");
+  for (size_t start=0; start<=list.size(); ) {
+    size_t end = list.find(',', start);
+    if (end==std::string::npos) end = list.size();
+    std::string name = list.substr(start, end-start);
+    size_t b = name.find_first_not_of(" \t"), e = name.find_last_not_of(" \t");
+    if (b!=std::string::npos) names.push_back(name.substr(b, e-b+1));
+    start = end+1;
+  }
+  size_t header = static_cast<size_t>(this->HeaderBytes);
+  if (header>file.Size) {
+    vtkErrorMacro(<< this->FileName << " is smaller than its header");
+    return 0;
+  }
+  size_t stride = sizeof(float)*(3+names.size());
+  vtkIdType N = static_cast<vtkIdType>((file.Size-header)/stride);
+  if ((file.Size-header)%stride!=0) {
+    vtkWarningMacro(<< "Ignoring the last " << (file.Size-header)%stride
+      << " bytes of " << this->FileName);
+  }
+  vtkIdType first = N*piece/pieces;
+  vtkIdType n     = N*(piece+1)/pieces - first;
+  char *base = static_cast<char*>(file.Data) + header;
+  //
+  // nothing is copied, the pages of this piece are read ahead in the
+  // background while the pipeline goes on
+  //
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetData(vtkMIPMappedParticleSource_Wrap(this->Mapping,
+    base + first*3*sizeof(float), 3, n, "Points"));
+  MIPAdviseSequential(file, header + first*3*sizeof(float), n*3*sizeof(float));
+  output->SetPoints(points);
+  for (size_t k=0; k<names.size(); k++) {
+    size_t offset = (3*N + k*N + first)*sizeof(float);
+    vtkSmartPointer<vtkFloatArray> scalars = vtkMIPMappedParticleSource_Wrap(
+      this->Mapping, base + offset, 1, n, names[k].c_str());
+    MIPAdviseSequential(file, header + offset, n*sizeof(float));
+    output->GetPointData()->AddArray(scalars);
+    if (k==0) {
+      output->GetPointData()->SetActiveScalars(names[k].c_str());
+    }
+  }
+  return 1;
+}
+//----------------------------------------------------------------------------
+void vtkMIPMappedParticleSource::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << (this->FileName ? this->FileName : "(none)") << "\n";
+  os << indent << "HeaderBytes: " << this->HeaderBytes << "\n";
+  os << indent << "ScalarNames: " << (this->ScalarNames ? this->ScalarNames : "(none)") << "\n";
+}
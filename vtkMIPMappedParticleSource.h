@@ -0,0 +1,88 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMIPMappedParticleSource.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkMIPMappedParticleSource - zero copy source of raw particle files
+// .SECTION Description
+// Reads raw snapshots of little-endian 32 bit floats : after
+// HeaderBytes bytes come the xyz interleaved positions of the N particles,
+// then one array of N values for each name of ScalarNames (comma
+// separated), N follows from the file size. The file is memory mapped
+// (see MIPMappedFile) and the output points and point data arrays wrap the
+// mapping directly : nothing is copied, and only the pages of this
+// process's piece are ever read (ahead, in the background). The mapping is
+// released when the last array using it is deleted.
+// The output is a vtkPolyData without cells, in pieces of contiguous
+// particles. On big-endian hosts the arrays are byte swapped copies.
+//
+// .SECTION See Also
+// vtkMIPRepresentation MIPMappedFile
+
+#ifndef __vtkMIPMappedParticleSource_h
+#define __vtkMIPMappedParticleSource_h
+
+#include "vtkPolyDataAlgorithm.h"
+
+class vtkInformationObjectBaseKey;
+class vtkMIPMappedFile;
+
+class VTK_EXPORT vtkMIPMappedParticleSource : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkMIPMappedParticleSource* New();
+  vtkTypeMacro(vtkMIPMappedParticleSource, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  // Description:
+  // The snapshot file.
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+
+  // Description:
+  // Bytes skipped at the start of the file, a multiple of 4. 0 by default.
+  vtkSetMacro(HeaderBytes, vtkIdType);
+  vtkGetMacro(HeaderBytes, vtkIdType);
+
+  // Description:
+  // Names of the scalar arrays following the positions, comma separated
+  // (e.g. "Density,Temperature"). None by default.
+  vtkSetStringMacro(ScalarNames);
+  vtkGetStringMacro(ScalarNames);
+
+  // Description:
+  // Set on the information of every output array, it holds the mapping
+  // the array points into.
+  static vtkInformationObjectBaseKey *MAPPED_FILE();
+
+//BTX
+protected:
+   vtkMIPMappedParticleSource();
+  ~vtkMIPMappedParticleSource();
+
+  virtual int RequestInformation(vtkInformation*, vtkInformationVector**, vtkInformationVector*);
+  virtual int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*);
+
+  char             *FileName;
+  vtkIdType         HeaderBytes;
+  char             *ScalarNames;
+
+  // The current mapping and the file it maps, remapped when it changes
+  vtkMIPMappedFile *Mapping;
+
+private:
+  vtkMIPMappedParticleSource(const vtkMIPMappedParticleSource&); // Not implemented.
+  void operator=(const vtkMIPMappedParticleSource&); // Not implemented.
+//ETX
+};
+
+#endif
@@ -0,0 +1,57 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMIPMapper.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkMIPMapper.h"
+
+#include "vtkExecutive.h"
+#include "vtkMath.h"
+#include "vtkObjectFactory.h"
+#include "vtkPainter.h"
+
+vtkStandardNewMacro(vtkMIPMapper);
+//----------------------------------------------------------------------------
+vtkMIPMapper::vtkMIPMapper()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkMIPMapper::~vtkMIPMapper()
+{
+}
+
+//----------------------------------------------------------------------------
+double *vtkMIPMapper::GetBounds()
+{
+  if (!this->GetExecutive()->GetInputData(0, 0)) {
+    vtkMath::UninitializeBounds(this->Bounds);
+    return this->Bounds;
+  }
+  // the superclass only recomputes the bounds when the pipeline changed,
+  // the painter knows when they need reducing again
+  this->Update();
+  this->ComputeBounds();
+  return this->Bounds;
+}
+
+//----------------------------------------------------------------------------
+void vtkMIPMapper::ComputeBounds()
+{
+  vtkMath::UninitializeBounds(this->Bounds);
+  if (this->GetPainter()) {
+    this->GetPainter()->UpdateBounds(this->Bounds);
+  }
+  this->BoundsMTime.Modified();
+}
+
+//----------------------------------------------------------------------------
@@ -0,0 +1,62 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMIPMapper.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkMIPMapper - painter mapper for point sets and composite datasets
+//
+// .SECTION Description
+//  vtkMIPMapper accepts point sets as well as composite datasets and hands
+//  the whole input to its painter, the vtkMIPPainter then draws all the
+//  leaves into one image. Unlike vtkCompositePolyDataMapper2, the bounds
+//  are those reported by the painter (the bounds of the whole dataset over
+//  all processes), so that IceT composites the whole image.
+//  The painter caches the bounds, they are asked for on every call since
+//  they depend on painter settings (the splat radii) too.
+//
+// .SECTION See Also
+//  vtkMIPDefaultPainter vtkMIPPainter vtkMIPRepresentation
+
+#ifndef __vtkMIPMapper_h
+#define __vtkMIPMapper_h
+
+#include "vtkCompositePolyDataMapper2.h"
+
+class VTK_EXPORT vtkMIPMapper : public vtkCompositePolyDataMapper2
+{
+public:
+  static vtkMIPMapper* New();
+  vtkTypeMacro(vtkMIPMapper, vtkCompositePolyDataMapper2);
+
+  // Description:
+  // The global bounds of the input, from the painter.
+  // This is a collective call.
+  virtual double *GetBounds();
+  virtual void GetBounds(double bounds[6])
+    { this->Superclass::GetBounds(bounds); }
+
+//BTX
+protected:
+   vtkMIPMapper();
+  ~vtkMIPMapper();
+
+  // Description:
+  // Ask the painter for the bounds.
+  virtual void ComputeBounds();
+
+private:
+  vtkMIPMapper(const vtkMIPMapper&); // Not implemented.
+  void operator=(const vtkMIPMapper&); // Not implemented.
+//ETX
+};
+
+#endif
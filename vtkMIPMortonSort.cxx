@@ -0,0 +1,198 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMIPMortonSort.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkMIPMortonSort.h"
+
+#include "vtkCellArray.h"
+#include "vtkDataArray.h"
+#include "vtkFieldData.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkIntArray.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPointSet.h"
+#include "vtkPolyData.h"
+#include "vtkSmartPointer.h"
+#include "vtkTimerLog.h"
+//
+#include "MIPMorton.h"
+
+#include <vector>
+
+vtkStandardNewMacro(vtkMIPMortonSort);
+//----------------------------------------------------------------------------
+vtkMIPMortonSort::vtkMIPMortonSort()
+{
+  this->Enabled = 0;
+}
+//----------------------------------------------------------------------------
+vtkMIPMortonSort::~vtkMIPMortonSort()
+{
+}
+//----------------------------------------------------------------------------
+template <typename T>
+void vtkMIPMortonSort_Gather(vtkDataArray *in, vtkDataArray *out, T *,
+  const std::vector<MIPIdType> &order)
+{
+  MIPGatherTuples(static_cast<const T*>(in->GetVoidPointer(0)),
+    in->GetNumberOfComponents(), &order[0], static_cast<MIPIdType>(order.size()),
+    static_cast<T*>(out->GetVoidPointer(0)));
+}
+//----------------------------------------------------------------------------
+// A copy of array with its tuples in the given order, numeric arrays are
+// copied in parallel, others (strings ...) tuple by tuple.
+static vtkAbstractArray *vtkMIPMortonSort_Reorder(vtkAbstractArray *array,
+  const std::vector<MIPIdType> &order)
+{
+  vtkIdType N = static_cast<vtkIdType>(order.size());
+  vtkAbstractArray *out = array->NewInstance();
+  out->SetName(array->GetName());
+  out->SetNumberOfComponents(array->GetNumberOfComponents());
+  out->SetNumberOfTuples(N);
+  vtkDataArray *din = vtkDataArray::SafeDownCast(array);
+  vtkDataArray *dout = vtkDataArray::SafeDownCast(out);
+  if (din && dout && N>0) {
+    switch (din->GetDataType()) {
+      vtkTemplateMacro(
+        vtkMIPMortonSort_Gather(din, dout, static_cast<VTK_TT*>(NULL), order);
+        return out);
+    }
+  }
+  for (vtkIdType i=0; i<N; i++) {
+    out->SetTuple(i, order[i], array);
+  }
+  return out;
+}
+//----------------------------------------------------------------------------
+// Renumber the points of the cells, newid[old point id] = new point id
+static void vtkMIPMortonSort_Renumber(vtkCellArray *cells,
+  const std::vector<vtkIdType> &newid)
+{
+  if (!cells || cells->GetNumberOfCells()==0) {
+    return;
+  }
+  vtkSmartPointer<vtkCellArray> renumbered = vtkSmartPointer<vtkCellArray>::New();
+  renumbered->Allocate(cells->GetNumberOfConnectivityEntries());
+  std::vector<vtkIdType> ids;
+  vtkIdType npts, *pts;
+  for (cells->InitTraversal(); cells->GetNextCell(npts, pts); ) {
+    ids.resize(npts);
+    for (vtkIdType j=0; j<npts; j++) {
+      ids[j] = newid[pts[j]];
+    }
+    renumbered->InsertNextCell(npts, npts ? &ids[0] : NULL);
+  }
+  cells->DeepCopy(renumbered);
+}
+//----------------------------------------------------------------------------
+int vtkMIPMortonSort::RequestData(vtkInformation*,
+  vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPointSet *input = vtkPointSet::GetData(inputVector[0]);
+  vtkPointSet *output = vtkPointSet::GetData(outputVector);
+  vtkPoints *pts = input->GetPoints();
+  vtkIdType N = pts ? pts->GetNumberOfPoints() : 0;
+  bool sortable = (pts && (pts->GetDataType()==VTK_FLOAT || pts->GetDataType()==VTK_DOUBLE));
+  if (!this->Enabled || N<2 || !sortable ||
+      (input->GetNumberOfCells()>0 && !vtkPolyData::SafeDownCast(input))) {
+    if (this->Enabled && N>1) {
+      vtkWarningMacro(<< "Only float/double points of point clouds or polydata are sorted");
+    }
+    output->ShallowCopy(input);
+    return 1;
+  }
+  double start = vtkTimerLog::GetUniversalTime();
+  //
+  // the Z-order of the points, then all point arrays are gathered in that order
+  //
+  std::vector<MIPIdType> order;
+  if (pts->GetDataType()==VTK_FLOAT) {
+    MIPMortonOrder(static_cast<const float*>(pts->GetData()->GetVoidPointer(0)), N, order);
+  }
+  else {
+    MIPMortonOrder(static_cast<const double*>(pts->GetData()->GetVoidPointer(0)), N, order);
+  }
+  output->ShallowCopy(input);
+  vtkSmartPointer<vtkPoints> newPts = vtkSmartPointer<vtkPoints>::New();
+  vtkDataArray *coords = vtkDataArray::SafeDownCast(
+    vtkMIPMortonSort_Reorder(pts->GetData(), order));
+  newPts->SetData(coords);
+  coords->Delete();
+  output->SetPoints(newPts);
+  //
+  vtkPointData *inPD = input->GetPointData();
+  vtkPointData *outPD = output->GetPointData();
+  outPD->Initialize();
+  for (int a=0; a<inPD->GetNumberOfArrays(); a++) {
+    vtkAbstractArray *array = vtkMIPMortonSort_Reorder(inPD->GetAbstractArray(a), order);
+    int idx = outPD->AddArray(array);
+    array->Delete();
+    // keep the scalars/vectors/... attribute flags
+    for (int att=0; att<vtkDataSetAttributes::NUM_ATTRIBUTES; att++) {
+      if (inPD->GetAbstractAttribute(att)==inPD->GetAbstractArray(a)) {
+        outPD->SetActiveAttribute(idx, att);
+      }
+    }
+  }
+  //
+  // cells of polydata follow their points
+  //
+  vtkPolyData *poly = vtkPolyData::SafeDownCast(output);
+  if (poly && poly->GetNumberOfCells()>0) {
+    std::vector<vtkIdType> newid(N);
+    for (vtkIdType i=0; i<N; i++) {
+      newid[order[i]] = i;
+    }
+    vtkPolyData *inpoly = vtkPolyData::SafeDownCast(input);
+    vtkSmartPointer<vtkCellArray> verts = vtkSmartPointer<vtkCellArray>::New();
+    vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    vtkSmartPointer<vtkCellArray> strips = vtkSmartPointer<vtkCellArray>::New();
+    verts->DeepCopy(inpoly->GetVerts());
+    lines->DeepCopy(inpoly->GetLines());
+    polys->DeepCopy(inpoly->GetPolys());
+    strips->DeepCopy(inpoly->GetStrips());
+    vtkMIPMortonSort_Renumber(verts, newid);
+    vtkMIPMortonSort_Renumber(lines, newid);
+    vtkMIPMortonSort_Renumber(polys, newid);
+    vtkMIPMortonSort_Renumber(strips, newid);
+    poly->SetVerts(verts);
+    poly->SetLines(lines);
+    poly->SetPolys(polys);
+    poly->SetStrips(strips);
+  }
+  //
+  // mark the output as sorted
+  //
+  vtkSmartPointer<vtkFieldData> fd = vtkSmartPointer<vtkFieldData>::New();
+  if (input->GetFieldData()) {
+    fd->ShallowCopy(input->GetFieldData());
+  }
+  vtkSmartPointer<vtkIntArray> marker = vtkSmartPointer<vtkIntArray>::New();
+  marker->SetName("MIPMortonOrdered");
+  marker->InsertNextValue(1);
+  fd->AddArray(marker);
+  output->SetFieldData(fd);
+  vtkDebugMacro(<< "Morton sorted " << N << " points in "
+    << (vtkTimerLog::GetUniversalTime()-start)*1000.0 << " ms");
+  return 1;
+}
+//----------------------------------------------------------------------------
+void vtkMIPMortonSort::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Enabled: " << this->Enabled << "\n";
+}
@@ -0,0 +1,63 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMIPMortonSort.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkMIPMortonSort - sort particles along a Z-order curve
+// .SECTION Description
+// Reorders the points of a point set, together with all the point data
+// arrays, along a Z-order (Morton) curve over the bounds of the points, so
+// that the MIP projection writes to neighbouring pixels for consecutive
+// particles. Vertex/line/polygon cells of vtkPolyData are renumbered to
+// follow their points. The sort runs in parallel and only when the input
+// changes, the representation places this filter before its cache keeper.
+// When Enabled is off, the input is passed through.
+// The output gets a field data array named "MIPMortonOrdered" so that the
+// painter can tell sorted data apart in its timing output.
+//
+// .SECTION See Also
+// vtkMIPPainter vtkMIPRepresentation MIPMorton
+
+#ifndef __vtkMIPMortonSort_h
+#define __vtkMIPMortonSort_h
+
+#include "vtkPointSetAlgorithm.h"
+
+class VTK_EXPORT vtkMIPMortonSort : public vtkPointSetAlgorithm
+{
+public:
+  static vtkMIPMortonSort* New();
+  vtkTypeMacro(vtkMIPMortonSort, vtkPointSetAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  // Description:
+  // Turn the sorting on/off, off by default.
+  vtkSetMacro(Enabled, int);
+  vtkGetMacro(Enabled, int);
+  vtkBooleanMacro(Enabled, int);
+
+//BTX
+protected:
+   vtkMIPMortonSort();
+  ~vtkMIPMortonSort();
+
+  virtual int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*);
+
+  int Enabled;
+
+private:
+  vtkMIPMortonSort(const vtkMIPMortonSort&); // Not implemented.
+  void operator=(const vtkMIPMortonSort&); // Not implemented.
+//ETX
+};
+
+#endif
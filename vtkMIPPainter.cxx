@@ -29,6 +29,7 @@
 #include "vtkCompositeDataSet.h"
 #include "vtkDataArray.h"
 #include "vtkDataSetAttributes.h"
+#include "vtkFieldData.h"
 #include "vtkGraphicsFactory.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
@@ -48,17 +49,37 @@
 #include "vtkCellArray.h"
 #include "vtkFloatArray.h"
 #include "vtkDoubleArray.h"
+#include "vtkVersionMacros.h"
+#if VTK_MAJOR_VERSION>7 || (VTK_MAJOR_VERSION==7 && VTK_MINOR_VERSION>=1)
+  #define VTK_MIP_HAVE_SOA
+  #include "vtkSOADataArrayTemplate.h"
+#endif
 //
 #ifdef VTK_USE_MPI
 #include "vtkMPICommunicator.h"
 #endif
 #include "vtkMultiProcessController.h"
+#include "vtkMIPCompositor.h"
+#include "vtkMIPScalarCache.h"
+//
+#include "MIPProjection.h"
+#include "MIPColourMap.h"
+#include "MIPOperator.h"
+#include "MIPPartition.h"
+#include "MIPTree.h"
+#include "MIPSubsample.h"
+#include "MIPSplat.h"
+#include "MIPScalars.h"
+#include "MIPPick.h"
+#include "MIPSparse.h"
+#include "MIPBuffer.h"
 
 #include <assert.h>
 
 #undef min
 #undef max
 #include <algorithm>
+#include <fstream>
 
 #include "vtkOpenGL.h"
 #include "vtkgl.h"
@@ -68,6 +89,7 @@
 vtkInstantiatorNewMacro(vtkMIPPainter);
 vtkCxxSetObjectMacro(vtkMIPPainter, Controller, vtkMultiProcessController);
 vtkCxxSetObjectMacro(vtkMIPPainter, ScalarsToColorsPainter, vtkScalarsToColorsPainter);
+vtkCxxSetObjectMacro(vtkMIPPainter, ScalarCache, vtkMIPScalarCache);
 //----------------------------------------------------------------------------
 
 template<typename T> class RGB_tuple
@@ -117,11 +139,39 @@ vtkMIPPainter::vtkMIPPainter()
 {
   this->TypeScalars            = NULL;
   this->ActiveScalars          = NULL;
+  this->RadiusScalars          = NULL;
+  this->SplatKernel            = MIP_SPLAT_CUBIC_SPLINE;
+  this->Operator               = MIP_OPERATOR_MAX;
+  this->WeightScalars          = NULL;
   this->NumberOfParticleTypes  = 0;
   this->SetNumberOfParticleTypes(1); 
   this->ScalarsToColorsPainter = NULL;
   this->Controller             = NULL;
   this->SetController(vtkMultiProcessController::GetGlobalController());
+  this->ScalarCache            = vtkMIPScalarCache::New();
+  this->Compositor             = vtkMIPCompositor::New();
+  this->ColourTable            = new MIPColourTable;
+  this->ColourTableTime        = 0;
+  this->TypePartition          = new MIPTypePartition;
+  this->SpatialTree            = new MIPTree;
+  this->SpatialCulling         = 0;
+  this->TileBinning            = 0;
+  this->Subsample              = new MIPSubsample;
+  this->SubsampleLOD           = 0;
+  this->SubsampleDrawn         = 0;
+  this->FrameBudget            = 0.04;
+  this->ProjectionRate         = 0.0;
+  this->ProjectionTime         = 0.0;
+  this->OrderedRates[0]        = 0.0;
+  this->OrderedRates[1]        = 0.0;
+  this->PickBuffers            = 0;
+  this->PickImage              = new MIPPickImage;
+  this->FrameBuffers           = new MIPFrameBuffers;
+  vtkMath::UninitializeBounds(this->GlobalBounds);
+  this->FrameNumber            = 0;
+  this->TimingLogFile          = NULL;
+  std::fill(this->LocalStatistics, this->LocalStatistics+NUMBER_OF_STATISTICS, 0.0);
+  std::fill(this->FrameStatistics, this->FrameStatistics+3*NUMBER_OF_STATISTICS, 0.0);
   //
   this->ArrayName = NULL;
   this->ArrayId = -1;
@@ -139,31 +189,212 @@ vtkMIPPainter::~vtkMIPPainter()
   delete []this->ArrayName;
   delete []this->TypeScalars;
   delete []this->ActiveScalars;
+  delete []this->RadiusScalars;
+  delete []this->WeightScalars;
+  delete []this->TimingLogFile;
+  this->SetScalarCache(NULL);
+  this->Compositor->Delete();
+  delete this->ColourTable;
+  delete this->TypePartition;
+  delete this->SpatialTree;
+  delete this->Subsample;
+  delete this->PickImage;
+  delete this->FrameBuffers;
 }
 // ---------------------------------------------------------------------------
 void vtkMIPPainter::UpdateBounds(double bounds[6])
 {
-  vtkPointSet *input = vtkPointSet::SafeDownCast(this->GetInput());
-  // if it hasn't been set yet, abort.
-  if (!input) return;
-  input->GetBounds(bounds);
+  vtkDataObject *input = this->GetInput();
+  // the bounds of a composite input are those of all its point set leaves
+  std::vector<vtkPointSet*> leaves;
+  if (vtkPointSet::SafeDownCast(input)) {
+    leaves.push_back(vtkPointSet::SafeDownCast(input));
+  }
+  else if (vtkCompositeDataSet::SafeDownCast(input)) {
+    vtkSmartPointer<vtkCompositeDataIterator> iter;
+    iter.TakeReference(vtkCompositeDataSet::SafeDownCast(input)->NewIterator());
+    for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem()) {
+      vtkPointSet *leaf = vtkPointSet::SafeDownCast(iter->GetCurrentDataObject());
+      if (leaf) {
+        leaves.push_back(leaf);
+      }
+    }
+  }
+  else {
+    // if it hasn't been set yet, abort.
+    return;
+  }
+  double start = vtkTimerLog::GetUniversalTime();
   //
-  if (this->Controller) {
-    double mins[3]  = {bounds[0], bounds[2], bounds[4]};
-    double maxes[3] = {bounds[1], bounds[3], bounds[5]};
-    double globalMins[3], globalMaxes[3];
-    this->Controller->AllReduce(mins, globalMins, 3, vtkCommunicator::MIN_OP);
-    this->Controller->AllReduce(maxes, globalMaxes, 3, vtkCommunicator::MAX_OP);
-    bounds[0] = globalMins[0];  bounds[1] = globalMaxes[0];
-    bounds[2] = globalMins[1];  bounds[3] = globalMaxes[1];
-    bounds[4] = globalMins[2];  bounds[5] = globalMaxes[2];
+  // ParaView asks for the bounds several times per frame, they are only
+  // computed and reduced again when the data changes. A data update
+  // re-executes the pipeline on every process, so all of them see a new
+  // MTime and still agree on whether to take part in the collective.
+  //
+  std::vector<double> key;
+  key.push_back(static_cast<double>(input->GetMTime()));
+  // the radius array may only exist where there are points, the setting
+  // (in the painter MTime) is the same everywhere
+  key.push_back(static_cast<double>(this->GetMTime()));
+  key.push_back(this->Controller ? this->Controller->GetNumberOfProcesses() : 0);
+  if (key==this->BoundsKey) {
+    memcpy(bounds, this->GlobalBounds, sizeof(this->GlobalBounds));
+    this->LocalStatistics[BOUNDS_TIME] = vtkTimerLog::GetUniversalTime() - start;
+    return;
+  }
+  //
+  // processes without points contribute neutral values rather than the
+  // uninitialized bounds of an empty dataset, the mins are sent negated
+  // so that one MAX_OP reduces all six values
+  //
+  double extent[6] = { -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX,
+                       -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+  for (size_t l=0; l<leaves.size(); l++) {
+    if (leaves[l]->GetNumberOfPoints()==0) {
+      continue;
+    }
+    double local[6];
+    leaves[l]->GetBounds(local);
+    // splats reach beyond the particle centres
+    vtkDataArray *radii = this->RadiusScalars ?
+      leaves[l]->GetPointData()->GetArray(this->RadiusScalars) : NULL;
+    double r = radii ? std::max(radii->GetRange(0)[1], 0.0) : 0.0;
+    for (int i=0; i<3; i++) {
+      extent[i]   = std::max(extent[i],   -(local[2*i] - r));
+      extent[i+3] = std::max(extent[i+3],   local[2*i+1] + r);
+    }
+  }
+  if (this->Controller && this->Controller->GetNumberOfProcesses()>1) {
+    double global[6];
+    this->Controller->AllReduce(extent, global, 6, vtkCommunicator::MAX_OP);
+    memcpy(extent, global, sizeof(extent));
+  }
+  for (int i=0; i<3; i++) {
+    bounds[2*i]   = -extent[i];
+    bounds[2*i+1] =  extent[i+3];
+  }
+  if (bounds[0]>bounds[1]) {
+    // no points anywhere
+    vtkMath::UninitializeBounds(bounds);
+  }
+  memcpy(this->GlobalBounds, bounds, sizeof(this->GlobalBounds));
+  this->BoundsKey.swap(key);
+  this->LocalStatistics[BOUNDS_TIME] = vtkTimerLog::GetUniversalTime() - start;
+}
+// ---------------------------------------------------------------------------
+const char *vtkMIPPainter::GetStatisticName(int s)
+{
+  static const char *names[NUMBER_OF_STATISTICS] = {
+    "project_time", "composite_time", "colour_time", "draw_time",
+    "bounds_time", "particles", "bytes_sent", "occupied_pixels",
+    "morton_ordered", "project_rate", "morton_speedup" };
+  return (s>=0 && s<NUMBER_OF_STATISTICS) ? names[s] : "";
+}
+// ---------------------------------------------------------------------------
+void vtkMIPPainter::GatherFrameStatistics()
+{
+  const int P = this->Controller->GetNumberOfProcesses();
+  std::vector<double> all(this->LocalStatistics, this->LocalStatistics+NUMBER_OF_STATISTICS);
+  if (P>1) {
+    all.resize(P*NUMBER_OF_STATISTICS);
+    this->Controller->Gather(this->LocalStatistics, &all[0], NUMBER_OF_STATISTICS, 0);
+  }
+  this->FrameNumber++;
+  if (this->Controller->GetLocalProcessId()!=0) {
+    return;
+  }
+  for (int s=0; s<NUMBER_OF_STATISTICS; s++) {
+    double lo = all[s], hi = all[s], sum = 0.0;
+    for (int p=0; p<P; p++) {
+      double v = all[p*NUMBER_OF_STATISTICS + s];
+      lo   = std::min(lo, v);
+      hi   = std::max(hi, v);
+      sum += v;
+    }
+    this->FrameStatistics[3*s]   = lo;
+    this->FrameStatistics[3*s+1] = hi;
+    this->FrameStatistics[3*s+2] = sum/P;
+  }
+  this->FrameStatisticsTime.Modified();
+  if (!this->TimingLogFile || !*this->TimingLogFile) {
+    return;
+  }
+  bool fresh = true;
+  {
+    std::ifstream probe(this->TimingLogFile);
+    fresh = !probe.good() || probe.peek()==std::ifstream::traits_type::eof();
+  }
+  std::ofstream log(this->TimingLogFile, std::ios::app);
+  if (!log) {
+    vtkWarningMacro(<< "Cannot open timing log " << this->TimingLogFile);
+    return;
+  }
+  if (fresh) {
+    log << "frame,processes";
+    for (int s=0; s<NUMBER_OF_STATISTICS; s++) {
+      const char *name = vtkMIPPainter::GetStatisticName(s);
+      log << "," << name << "_min," << name << "_max," << name << "_avg";
+    }
+    log << "\n";
+  }
+  log.precision(9);
+  log << this->FrameNumber << "," << P;
+  for (int s=0; s<3*NUMBER_OF_STATISTICS; s++) {
+    log << "," << this->FrameStatistics[s];
+  }
+  log << "\n";
+}
+// ---------------------------------------------------------------------------
+bool vtkMIPPainter::GetPickedParticle(int x, int y, vtkIdType &id, int &process,
+  double &depth, double &value)
+{
+  const MIPPickImage &pickImage = *this->PickImage;
+  if (x<0 || y<0 || x>=pickImage.Size[0] || y>=pickImage.Size[1]) {
+    return false;
+  }
+  const MIPPickRecord &record =
+    pickImage.Records[static_cast<vtkIdType>(y)*pickImage.Size[0] + x];
+  if (record.Id<0) {
+    return false;
+  }
+  id      = static_cast<vtkIdType>(record.Id);
+  process = record.Rank;
+  depth   = record.Depth;
+  value   = record.Value;
+  return true;
+}
+// ---------------------------------------------------------------------------
+void vtkMIPPainter::SetReductionPrecision(int precision)
+{
+  if (precision!=this->Compositor->GetPrecision()) {
+    this->Compositor->SetPrecision(precision);
+    this->Modified();
+  }
+}
+// ---------------------------------------------------------------------------
+int vtkMIPPainter::GetReductionPrecision()
+{
+  return this->Compositor->GetPrecision();
+}
+// ---------------------------------------------------------------------------
+void vtkMIPPainter::SetCompositingMode(int mode)
+{
+  if (mode!=this->Compositor->GetCompositingMode()) {
+    this->Compositor->SetCompositingMode(mode);
+    this->Modified();
   }
 }
 // ---------------------------------------------------------------------------
+int vtkMIPPainter::GetCompositingMode()
+{
+  return this->Compositor->GetCompositingMode();
+}
+// ---------------------------------------------------------------------------
 void vtkMIPPainter::SetNumberOfParticleTypes(int N)
 {
   this->NumberOfParticleTypes = std::max(N,this->NumberOfParticleTypes);
-  this->TypeActive.resize(this->NumberOfParticleTypes,0);
+  // types are drawn until they are switched off
+  this->TypeActive.resize(this->NumberOfParticleTypes,1);
 }
 // ---------------------------------------------------------------------------
 void vtkMIPPainter::SetTypeActive(int ptype, int a)
@@ -179,6 +410,91 @@ int vtkMIPPainter::GetTypeActive(int ptype)
   return this->TypeActive[ptype];
 }
 //-----------------------------------------------------------------------------
+// The type and active arrays are read in their native type, the first
+// component is used like GetTuple1 would.
+template <typename T>
+void vtkMIP_NonZeroMask(vtkDataArray *active, T *, std::vector<unsigned char> &mask)
+{
+  MIPNonZeroMask(static_cast<const T*>(active->GetVoidPointer(0)),
+    active->GetNumberOfComponents(), static_cast<MIPIdType>(mask.size()), &mask[0]);
+}
+//-----------------------------------------------------------------------------
+template <typename T>
+void vtkMIP_PartitionByType(vtkDataArray *types, T *, const unsigned char *mask,
+  vtkIdType N, int ntypes, MIPTypePartition &partition)
+{
+  MIPPartitionByType(static_cast<const T*>(types->GetVoidPointer(0)),
+    types->GetNumberOfComponents(), mask, N, ntypes, partition);
+}
+//-----------------------------------------------------------------------------
+void vtkMIPPainter::UpdateTypePartition(vtkDataArray *types, vtkDataArray *active, vtkIdType N)
+{
+  std::vector<double> key;
+  key.push_back(types ? static_cast<double>(types->GetMTime()) : -1.0);
+  key.push_back(active ? static_cast<double>(active->GetMTime()) : -1.0);
+  key.push_back(static_cast<double>(N));
+  key.push_back(this->NumberOfParticleTypes);
+  if (key==this->TypePartitionKey) {
+    return;
+  }
+  std::vector<unsigned char> mask;
+  if (active) {
+    mask.resize(N);
+    switch (active->GetDataType()) {
+      vtkTemplateMacro(vtkMIP_NonZeroMask(active, static_cast<VTK_TT*>(NULL), mask));
+      default:
+        vtkWarningMacro(<< "Active array " << active->GetName() << " is not numeric, ignored");
+        mask.clear();
+    }
+  }
+  const unsigned char *m = mask.empty() ? NULL : &mask[0];
+  bool done = false;
+  if (types) {
+    switch (types->GetDataType()) {
+      vtkTemplateMacro(
+        vtkMIP_PartitionByType(types, static_cast<VTK_TT*>(NULL), m, N,
+          this->NumberOfParticleTypes, *this->TypePartition);
+        done = true);
+      default:
+        vtkWarningMacro(<< "Type array " << types->GetName() << " is not numeric, ignored");
+    }
+  }
+  if (!done) {
+    MIPPartitionByType(static_cast<const int*>(NULL), 1, m, N,
+      this->NumberOfParticleTypes, *this->TypePartition);
+  }
+  this->TypePartitionKey.swap(key);
+}
+//-----------------------------------------------------------------------------
+void vtkMIPPainter::UpdateColourTable(vtkScalarsToColors *s2c)
+{
+  double *range = s2c->GetRange();
+  bool log = s2c->UsingLogScale()!=0;
+  if (this->ColourTableTime==s2c->GetMTime() &&
+      this->ColourTable->Range[0]==range[0] &&
+      this->ColourTable->Range[1]==range[1] &&
+      !this->ColourTable->RGBA.empty())
+  {
+    return;
+  }
+  // the lookuptable is only used here, outside of any threaded code
+  std::vector<double> values;
+  MIPInitializeColourTable(*this->ColourTable, MIP_COLOUR_TABLE_SIZE, range, log, values);
+  s2c->Build();
+  s2c->MapScalarsThroughTable2(&values[0], &this->ColourTable->RGBA[0],
+    VTK_DOUBLE, static_cast<int>(values.size()), 1, VTK_RGBA);
+  // the lookup table decides whether these are clamped or have their own
+  // colours (NanColor, Use{Below,Above}RangeColor)
+  const double span = std::max(range[1]-range[0], 1.0);
+  const bool tableLog = this->ColourTable->Log;
+  const double below = tableLog ? 0.5*range[0] : range[0] - span;
+  const double above = tableLog ? 2.0*range[1] : range[1] + span;
+  memcpy(this->ColourTable->NaN, s2c->MapValue(vtkMath::Nan()), 4);
+  memcpy(this->ColourTable->Below, s2c->MapValue(below), 4);
+  memcpy(this->ColourTable->Above, s2c->MapValue(above), 4);
+  this->ColourTableTime = s2c->GetMTime();
+}
+//-----------------------------------------------------------------------------
 void vtkMIPPainter::ProcessInformation(vtkInformation* info)
 {
   if (info->Has(vtkScalarsToColorsPainter::USE_LOOKUP_TABLE_SCALAR_RANGE()))
@@ -242,9 +558,407 @@ void vtkMIP_FloatOrDoubleArrayPointer(vtkDataArray *dataarray, float *&F, double
   }                                                                                
 }                                                                                  
 //----------------------------------------------------------------------------
-#define FloatOrDouble(F, D, index) F ? F[index] : D[index]
 #define FloatOrDoubleSet(F, D) ((F!=NULL) || (D!=NULL))
 //----------------------------------------------------------------------------
+// The smoothing lengths (first component of the radius array) and kernel
+// used when the particles are drawn as splats.
+struct vtkMIPSplat
+{
+  float  *RadiiF;
+  double *RadiiD;
+  int     Stride;
+  int     Kernel;
+};
+//----------------------------------------------------------------------------
+// The local image the particles were projected into and the winner of each
+// of its pixels, filled in by a second pass when picking.
+struct vtkMIPPick
+{
+  const double *Image;
+  MIPIdType    *Winners;
+};
+//----------------------------------------------------------------------------
+// Project the points using the scalars directly in their native type, the
+// data type and memory layout are resolved once here rather than per particle.
+// With splat not NULL the particles are splatted over their footprint, with
+// pick not NULL nothing is drawn and the winners of pick->Image are found.
+template <typename PT, typename ST>
+void vtkMIP_ProjectPointsIndexed(const MIPView &view, const PT *points,
+  const ST *scalars, const MIPIdType *index, vtkIdType N,
+  const vtkMIPSplat *splat, const vtkMIPPick *pick, double *image)
+{
+  if (pick) {
+    MIPFindWinners(view, points, scalars, 1, index, N, pick->Image, pick->Winners);
+  }
+  else if (splat && splat->RadiiF) {
+    MIPSplatPoints(view, points, scalars, 1, splat->RadiiF, splat->Stride,
+      index, N, splat->Kernel, image);
+  }
+  else if (splat && splat->RadiiD) {
+    MIPSplatPoints(view, points, scalars, 1, splat->RadiiD, splat->Stride,
+      index, N, splat->Kernel, image);
+  }
+  else if (index) {
+    MIPProjectPoints(view, points, scalars, 1, index, N, image);
+  }
+  else {
+    MIPProjectPoints(view, points, scalars, 1, N, image);
+  }
+}
+//----------------------------------------------------------------------------
+template <typename PT, typename T>
+void vtkMIP_ProjectPointsTyped(const MIPView &view, const PT *points,
+  const MIPIdType *index, vtkIdType N, vtkDataArray *scalars, T *,
+  const vtkMIPSplat *splat, const vtkMIPPick *pick, double *image)
+{
+#ifdef VTK_MIP_HAVE_SOA
+  vtkSOADataArrayTemplate<T> *soa = vtkArrayDownCast< vtkSOADataArrayTemplate<T> >(scalars);
+  if (soa) {
+    vtkMIP_ProjectPointsIndexed(view, points,
+      static_cast<const T*>(soa->GetComponentArrayPointer(0)), index, N, splat, pick, image);
+    return;
+  }
+#endif
+  const T *data = static_cast<const T*>(scalars->GetVoidPointer(0));
+  vtkMIP_ProjectPointsIndexed(view, points, data, index, N, splat, pick, image);
+}
+//----------------------------------------------------------------------------
+// Multi-component arrays are drawn using their magnitude, which is taken
+// from the cache so it is only recomputed when the array changes.
+// If index is not NULL only the N particles it lists are drawn.
+template <typename PT>
+void vtkMIP_ProjectPoints(const MIPView &view, const PT *points,
+  const MIPIdType *index, vtkIdType N, vtkDataArray *scalars,
+  vtkMIPScalarCache *cache, const vtkMIPSplat *splat, const vtkMIPPick *pick,
+  double *image)
+{
+  if (!scalars) {
+    vtkMIP_ProjectPointsIndexed(view, points, static_cast<const double*>(NULL),
+      index, N, splat, pick, image);
+    return;
+  }
+  if (scalars->GetNumberOfComponents()>1) {
+    vtkDoubleArray *magnitude = cache->GetMagnitude(scalars);
+    vtkMIP_ProjectPointsIndexed(view, points,
+      static_cast<const double*>(magnitude->GetPointer(0)), index, N, splat, pick, image);
+    return;
+  }
+  switch (scalars->GetDataType()) {
+    vtkTemplateMacro(
+      vtkMIP_ProjectPointsTyped(view, points, index, N, scalars,
+        static_cast<VTK_TT*>(NULL), splat, pick, image));
+    default:
+      vtkGenericWarningMacro(<< "MIP cannot use " << scalars->GetDataTypeAsString()
+        << " scalars, all particles will be drawn with value 0");
+      vtkMIP_ProjectPointsIndexed(view, points, static_cast<const double*>(NULL),
+        index, N, splat, pick, image);
+  }
+}
+//----------------------------------------------------------------------------
+// The ranges of partition->Index holding the particles of the active types,
+// consecutive active types are contiguous and merged into one range.
+typedef std::vector< std::pair<MIPIdType, MIPIdType> > vtkMIPRanges;
+void vtkMIP_ActiveRanges(const MIPTypePartition *partition,
+  const std::vector<int> &typeActive, vtkMIPRanges &ranges)
+{
+  const std::vector<MIPIdType> &offsets = partition->Offsets;
+  ranges.clear();
+  for (int t=0; t<=partition->NumberOfTypes; t++) {
+    // the last range holds the types without a setting, they are drawn
+    bool active = (t==partition->NumberOfTypes) || typeActive[t];
+    if (!active || offsets[t]==offsets[t+1]) {
+      continue;
+    }
+    if (!ranges.empty() && ranges.back().second==offsets[t]) {
+      ranges.back().second = offsets[t+1];
+    }
+    else {
+      ranges.push_back(std::make_pair(offsets[t], offsets[t+1]));
+    }
+  }
+}
+//----------------------------------------------------------------------------
+// Draw the particles of the active types. When every particle is drawn the
+// index is skipped altogether.
+template <typename PT>
+void vtkMIP_ProjectActiveTypes(const MIPView &view, const PT *points, vtkIdType N,
+  const MIPTypePartition *partition, const std::vector<int> &typeActive,
+  vtkDataArray *scalars, vtkMIPScalarCache *cache, const vtkMIPSplat *splat,
+  const vtkMIPPick *pick, double *image)
+{
+  vtkMIPRanges ranges;
+  vtkMIP_ActiveRanges(partition, typeActive, ranges);
+  for (size_t r=0; r<ranges.size(); r++) {
+    if (ranges[r].first==0 && ranges[r].second==N) {
+      vtkMIP_ProjectPoints(view, points, NULL, N, scalars, cache, splat, pick, image);
+    }
+    else {
+      vtkMIP_ProjectPoints(view, points, &partition->Index[ranges[r].first],
+        ranges[r].second-ranges[r].first, scalars, cache, splat, pick, image);
+    }
+  }
+}
+//----------------------------------------------------------------------------
+// Ids of the particles of the active types, NULL if all N particles are.
+const MIPIdType *vtkMIP_ActiveIds(const MIPTypePartition *partition,
+  const std::vector<int> &typeActive, vtkIdType N,
+  std::vector<MIPIdType> &ids, MIPIdType &n)
+{
+  vtkMIPRanges ranges;
+  vtkMIP_ActiveRanges(partition, typeActive, ranges);
+  n = N;
+  if (ranges.size()==1 && ranges[0].first==0 && ranges[0].second==N) {
+    return NULL;
+  }
+  ids.clear();
+  for (size_t r=0; r<ranges.size(); r++) {
+    ids.insert(ids.end(), partition->Index.begin()+ranges[r].first,
+      partition->Index.begin()+ranges[r].second);
+  }
+  n = static_cast<MIPIdType>(ids.size());
+  return ids.empty() ? NULL : &ids[0];
+}
+//----------------------------------------------------------------------------
+// A leaf of a composite input, with the values it is drawn with (and the
+// weights of a mean) already resolved to one component arrays, so that
+// several leaves can be drawn at the same time without the scalar cache.
+struct vtkMIPBlock
+{
+  vtkPointSet  *Input;
+  vtkIdType     N;
+  float        *PointsF;
+  double       *PointsD;
+  vtkDataArray *Values;
+  vtkDataArray *Weights;
+  vtkMIPSplat   Splat;
+  // number of the first particle among those of all the leaves
+  vtkIdType     Offset;
+};
+//----------------------------------------------------------------------------
+// Whether vtkMIPMortonSort tagged the data set as sorted
+static int vtkMIP_MortonOrdered(vtkDataSet *ds)
+{
+  vtkFieldData *fd = ds ? ds->GetFieldData() : NULL;
+  return (fd && fd->GetArray("MIPMortonOrdered")) ? 1 : 0;
+}
+//----------------------------------------------------------------------------
+// Blocks smaller than this are drawn by one thread each, all at the same
+// time, as a parallel projection of so few particles is mostly overhead.
+#define VTK_MIP_SMALL_BLOCK 262144
+//----------------------------------------------------------------------------
+// Draw the values (or weights) of the blocks into one image. The large
+// blocks (and all splatted ones) are drawn one after the other, each by
+// all threads, then the small ones are dealt out to the threads, which
+// update the shared image atomically (see MIPView::Concurrent).
+// The weights of blocks without a weight array are counted instead.
+void vtkMIP_ProjectBlocks(const MIPView &view, const std::vector<vtkMIPBlock> &blocks,
+  bool weights, vtkMIPScalarCache *cache, double *image)
+{
+  MIPView counted = view;
+  counted.Operator = MIP_OPERATOR_COUNT;
+  std::vector<int> small;
+  for (size_t b=0; b<blocks.size(); b++) {
+    const vtkMIPBlock &block = blocks[b];
+    const vtkMIPSplat *splat =
+      FloatOrDoubleSet(block.Splat.RadiiF, block.Splat.RadiiD) ? &block.Splat : NULL;
+    vtkDataArray *values = weights ? block.Weights : block.Values;
+    const MIPView &blockView = (weights && !values) ? counted : view;
+    if (block.N<VTK_MIP_SMALL_BLOCK && !splat) {
+      small.push_back(static_cast<int>(b));
+    }
+    else if (block.PointsF) {
+      vtkMIP_ProjectPoints(blockView, block.PointsF, NULL, block.N, values, cache, splat, NULL, image);
+    }
+    else {
+      vtkMIP_ProjectPoints(blockView, block.PointsD, NULL, block.N, values, cache, splat, NULL, image);
+    }
+  }
+  MIPView concurrent = view, concurrentCounted = counted;
+  concurrent.Concurrent = true;
+  concurrentCounted.Concurrent = true;
+  const int nsmall = static_cast<int>(small.size());
+#pragma omp parallel for schedule(dynamic,1)
+  for (int s=0; s<nsmall; s++) {
+    const vtkMIPBlock &block = blocks[small[s]];
+    vtkDataArray *values = weights ? block.Weights : block.Values;
+    const MIPView &blockView = (weights && !values) ? concurrentCounted : concurrent;
+    if (block.PointsF) {
+      vtkMIP_ProjectPoints(blockView, block.PointsF, NULL, block.N, values, cache, NULL, NULL, image);
+    }
+    else {
+      vtkMIP_ProjectPoints(blockView, block.PointsD, NULL, block.N, values, cache, NULL, NULL, image);
+    }
+  }
+}
+//----------------------------------------------------------------------------
+// Replace the particle numbers of the records by the global ids of input,
+// or offset them to number the particles of all blocks when it has none.
+void vtkMIP_GlobalPickIds(vtkPointSet *input, vtkIdType offset, vtkIdType npixels,
+  MIPPickRecord *records)
+{
+  vtkDataArray *globalIds = input->GetPointData()->GetGlobalIds();
+  for (vtkIdType i=0; i<npixels; i++) {
+    if (records[i].Id>=0) {
+      records[i].Id = globalIds ?
+        static_cast<MIPIdType>(globalIds->GetTuple1(records[i].Id)) : records[i].Id+offset;
+    }
+  }
+}
+//----------------------------------------------------------------------------
+// The tree and the subsample both hold a reordered copy of the particles
+template <typename PT, typename ST>
+void vtkMIP_BuildCopy(const PT *points, const ST *scalars, const MIPIdType *ids,
+  vtkIdType N, MIPTree &tree)
+{
+  MIPBuildTree(points, scalars, 1, ids, N, tree);
+}
+template <typename PT, typename ST>
+void vtkMIP_BuildCopy(const PT *points, const ST *scalars, const MIPIdType *ids,
+  vtkIdType N, MIPSubsample &subsample)
+{
+  MIPBuildSubsample(points, scalars, 1, ids, N, subsample);
+}
+//----------------------------------------------------------------------------
+template <typename PT, typename T, typename Copy>
+void vtkMIP_BuildCopyTyped(const PT *points, const MIPIdType *ids, vtkIdType N,
+  vtkDataArray *scalars, T *, Copy &copy)
+{
+#ifdef VTK_MIP_HAVE_SOA
+  vtkSOADataArrayTemplate<T> *soa = vtkArrayDownCast< vtkSOADataArrayTemplate<T> >(scalars);
+  if (soa) {
+    vtkMIP_BuildCopy(points, static_cast<const T*>(soa->GetComponentArrayPointer(0)),
+      ids, N, copy);
+    return;
+  }
+#endif
+  vtkMIP_BuildCopy(points, static_cast<const T*>(scalars->GetVoidPointer(0)), ids, N, copy);
+}
+//----------------------------------------------------------------------------
+// Copy the particles ids[0..N-1] (all if NULL) with their scalars, the
+// scalars are resolved as in vtkMIP_ProjectPoints.
+template <typename PT, typename Copy>
+void vtkMIP_BuildCopy(vtkPoints *pts, const MIPIdType *ids, vtkIdType N,
+  vtkDataArray *scalars, vtkMIPScalarCache *cache, Copy &copy)
+{
+  const PT *points = static_cast<const PT*>(pts->GetData()->GetVoidPointer(0));
+  if (scalars && scalars->GetNumberOfComponents()>1) {
+    vtkDoubleArray *magnitude = cache->GetMagnitude(scalars);
+    vtkMIP_BuildCopy(points, static_cast<const double*>(magnitude->GetPointer(0)), ids, N, copy);
+    return;
+  }
+  switch (scalars ? scalars->GetDataType() : VTK_VOID) {
+    vtkTemplateMacro(
+      vtkMIP_BuildCopyTyped(points, ids, N, scalars, static_cast<VTK_TT*>(NULL), copy));
+    default:
+      vtkMIP_BuildCopy(points, static_cast<const double*>(NULL), ids, N, copy);
+  }
+}
+//-----------------------------------------------------------------------------
+void vtkMIPPainter::GetSelectionKey(vtkPoints *pts, vtkDataArray *scalars,
+  std::vector<double> &key)
+{
+  key = this->TypePartitionKey;
+  key.push_back(static_cast<double>(pts->GetMTime()));
+  key.push_back(static_cast<double>(pts->GetData()->GetMTime()));
+  key.push_back(scalars ? static_cast<double>(scalars->GetMTime()) : -1.0);
+  key.insert(key.end(), this->TypeActive.begin(), this->TypeActive.end());
+}
+//-----------------------------------------------------------------------------
+void vtkMIPPainter::GetBlocks(vtkCompositeDataSet *input,
+  std::vector<vtkMIPBlock> &blocks, std::vector<double> &key)
+{
+  blocks.clear();
+  const bool weighted = (this->Operator==MIP_OPERATOR_MEAN) && this->WeightScalars;
+  vtkSmartPointer<vtkCompositeDataIterator> iter;
+  iter.TakeReference(input->NewIterator());
+  // empty leaves are numbered too, so the types are the same everywhere
+  iter->SkipEmptyNodesOff();
+  vtkIdType offset = 0;
+  int type = 0;
+  for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem(), type++) {
+    vtkPointSet *leaf = vtkPointSet::SafeDownCast(iter->GetCurrentDataObject());
+    vtkIdType N = (leaf && leaf->GetPoints()) ? leaf->GetNumberOfPoints() : 0;
+    if (N==0) {
+      key.push_back(-1.0);
+      continue;
+    }
+    int cellFlag = 0;
+    vtkDataArray *scalars = vtkAbstractMapper::GetScalars(leaf,
+      this->ScalarMode, this->ArrayAccessMode, this->ArrayId,
+      this->ArrayName, cellFlag);
+    vtkPointData *pd = leaf->GetPointData();
+    vtkDataArray *weights = weighted ? pd->GetArray(this->WeightScalars) : NULL;
+    vtkDataArray *radii = this->RadiusScalars ? pd->GetArray(this->RadiusScalars) : NULL;
+    key.push_back(static_cast<double>(leaf->GetMTime()));
+    key.push_back(scalars ? static_cast<double>(scalars->GetMTime()) : -1.0);
+    key.push_back(weights ? static_cast<double>(weights->GetMTime()) : -1.0);
+    key.push_back(radii ? static_cast<double>(radii->GetMTime()) : -1.0);
+    vtkMIPBlock block = { leaf, N, NULL, NULL, NULL, NULL,
+      { NULL, NULL, 1, this->SplatKernel }, offset };
+    offset += N;
+    vtkMIP_FloatOrDoubleArrayPointer(leaf->GetPoints()->GetData(), block.PointsF, block.PointsD);
+    // the leaves of inactive types are not drawn. Those missing the weights
+    // of a weighted mean are drawn with their particles counted as weights
+    bool active = (type>=this->NumberOfParticleTypes) || this->TypeActive[type];
+    if (!active || !FloatOrDoubleSet(block.PointsF, block.PointsD)) {
+      continue;
+    }
+    if (weights) {
+      block.Values  = this->ScalarCache->GetWeighted(scalars, weights);
+      block.Weights = (weights->GetNumberOfComponents()>1) ?
+        this->ScalarCache->GetMagnitude(weights) : weights;
+    }
+    else {
+      block.Values = (scalars && scalars->GetNumberOfComponents()>1) ?
+        this->ScalarCache->GetMagnitude(scalars) : scalars;
+    }
+    if (radii) {
+      vtkMIP_FloatOrDoubleArrayPointer(radii, block.Splat.RadiiF, block.Splat.RadiiD);
+      block.Splat.Stride = radii->GetNumberOfComponents();
+    }
+    blocks.push_back(block);
+  }
+}
+//-----------------------------------------------------------------------------
+void vtkMIPPainter::UpdateSpatialTree(vtkPoints *pts, vtkDataArray *scalars, vtkIdType N)
+{
+  std::vector<double> key;
+  this->GetSelectionKey(pts, scalars, key);
+  if (key==this->SpatialTreeKey) {
+    return;
+  }
+  // the tree only holds the particles of the active types
+  std::vector<MIPIdType> ids;
+  MIPIdType n;
+  const MIPIdType *idsp = vtkMIP_ActiveIds(this->TypePartition, this->TypeActive, N, ids, n);
+  if (pts->GetDataType()==VTK_FLOAT) {
+    vtkMIP_BuildCopy<float>(pts, idsp, n, scalars, this->ScalarCache, *this->SpatialTree);
+  }
+  else {
+    vtkMIP_BuildCopy<double>(pts, idsp, n, scalars, this->ScalarCache, *this->SpatialTree);
+  }
+  this->SpatialTreeKey.swap(key);
+}
+//-----------------------------------------------------------------------------
+bool vtkMIPPainter::UpdateSubsample(vtkPoints *pts, vtkDataArray *scalars, vtkIdType N)
+{
+  std::vector<double> key;
+  this->GetSelectionKey(pts, scalars, key);
+  if (key==this->SubsampleKey) {
+    return false;
+  }
+  std::vector<MIPIdType> ids;
+  MIPIdType n;
+  const MIPIdType *idsp = vtkMIP_ActiveIds(this->TypePartition, this->TypeActive, N, ids, n);
+  if (pts->GetDataType()==VTK_FLOAT) {
+    vtkMIP_BuildCopy<float>(pts, idsp, n, scalars, this->ScalarCache, *this->Subsample);
+  }
+  else {
+    vtkMIP_BuildCopy<double>(pts, idsp, n, scalars, this->ScalarCache, *this->Subsample);
+  }
+  this->SubsampleKey.swap(key);
+  return true;
+}
 //-----------------------------------------------------------------------------
 // IceT is not exported by paraview, so rather than force lots of include dirs
 // and libs, just manually set some defs which will keep the compiler happy
@@ -266,13 +980,57 @@ void vtkMIPPainter::Render(vtkRenderer* ren, vtkActor* actor,
   int Y = ren->GetSize()[1];
   vtkDataObject *indo = this->GetInput();
   vtkPointSet *input = vtkPointSet::SafeDownCast(indo);
-  vtkPoints *pts = input->GetPoints();
   //
-  vtkDataArray *TypeArray = this->TypeScalars ? 
-    input->GetPointData()->GetArray(this->TypeScalars) : NULL;  
+  // the leaves of a composite input are drawn as blocks, with their own
+  // arrays (see GetBlocks), the arrays below are those of a point set
+  //
+  vtkCompositeDataSet *composite = input ? NULL : vtkCompositeDataSet::SafeDownCast(indo);
+  vtkPointData *pd = input ? input->GetPointData() : NULL;
+  vtkPoints *pts = input ? input->GetPoints() : NULL;
+  //
+  vtkDataArray *TypeArray = (pd && this->TypeScalars) ?
+    pd->GetArray(this->TypeScalars) : NULL;
+  //
+  vtkDataArray *ActiveArray = (pd && this->ActiveScalars) ?
+    pd->GetArray(this->ActiveScalars) : NULL;
+  //
+  // particles with a radius (smoothing length) are splatted over their
+  // footprint, the radius array must be float or double
+  //
+  vtkDataArray *RadiusArray = (pd && this->RadiusScalars) ?
+    pd->GetArray(this->RadiusScalars) : NULL;
+  vtkMIPSplat splat = { NULL, NULL, 1, this->SplatKernel };
+  if (RadiusArray) {
+    vtkMIP_FloatOrDoubleArrayPointer(RadiusArray, splat.RadiiF, splat.RadiiD);
+    splat.Stride = RadiusArray->GetNumberOfComponents();
+  }
+  const vtkMIPSplat *splatting = FloatOrDoubleSet(splat.RadiiF, splat.RadiiD) ? &splat : NULL;
+  //
+  // the mean is the sum of the (weighted) values over the sum of the
+  // weights, or over the particle count
   //
-  vtkDataArray *ActiveArray = this->ActiveScalars ? 
-    input->GetPointData()->GetArray(this->ActiveScalars) : NULL;  
+  const int  op   = this->Operator;
+  const bool mean = (op==MIP_OPERATOR_MEAN);
+  vtkDataArray *WeightArray = (pd && mean && this->WeightScalars) ?
+    pd->GetArray(this->WeightScalars) : NULL;
+  // the subsample and the k-d tree only know the particle centres and
+  // values, and a partly drawn subsample would undercount sums. Both are
+  // copies of a single point set
+  const bool subsampleLOD   = this->SubsampleLOD && !splatting && !composite &&
+    (op==MIP_OPERATOR_MAX || op==MIP_OPERATOR_MIN);
+  const bool spatialCulling = this->SpatialCulling && !splatting && !mean && !composite;
+  // whether splatting is asked for, even if this process has no such
+  // array. RadiusScalars is NULL when no array is chosen
+  const bool splatSetting = (this->RadiusScalars!=NULL);
+  // only max and min pixels have a winning particle. Like the compositing,
+  // this must agree on all processes so it only depends on the settings
+  const bool picking = this->PickBuffers && !this->SubsampleLOD &&
+    !splatSetting && (op==MIP_OPERATOR_MAX || op==MIP_OPERATOR_MIN);
+  // bands are reduced while the projection goes on for plain projections,
+  // the others reduce all the bands at the end. Also settings only
+  const bool pipelined =
+    this->Compositor->GetCompositingMode()==vtkMIPCompositor::PIPELINED &&
+    !mean && !this->SubsampleLOD && !this->SpatialCulling && !splatSetting;
   //
   // Make sure we have the right color array and other info
   //
@@ -282,9 +1040,9 @@ void vtkMIPPainter::Render(vtkRenderer* ren, vtkActor* actor,
   //
   int cellFlag=0;
   vtkDataSet* ds = static_cast<vtkDataSet*>(input);
-  vtkDataArray* scalars = vtkAbstractMapper::GetScalars(ds,
+  vtkDataArray* scalars = ds ? vtkAbstractMapper::GetScalars(ds,
     this->ScalarMode, this->ArrayAccessMode, this->ArrayId,
-    this->ArrayName, cellFlag);
+    this->ArrayName, cellFlag) : NULL;
   vtkScalarsToColors *s2c = this->ScalarsToColorsPainter->GetLookupTable();
   if (!s2c) {
     this->ScalarsToColorsPainter->CreateDefaultLookupTable();
@@ -327,173 +1085,390 @@ void vtkMIPPainter::Render(vtkRenderer* ren, vtkActor* actor,
     0,1));
 
   //
-  // watch out, if one process has no points, pts array will be NULL
+  // The composited image only depends on the camera, the viewport, the data
+  // and the compositing settings. If none of them changed on any process
+  // (LUT, scalar range or background edits) we skip straight to the colour
+  // mapping. All processes must agree as the compositing is collective.
   //
-  vtkIdType N = pts ? pts->GetNumberOfPoints() : 0;
-  float *pointsF = NULL;
-  double *pointsD = NULL;
-  if (N>0) {
-    vtkMIP_FloatOrDoubleArrayPointer(pts->GetData(), pointsF, pointsD);
+  std::vector<double> key(matrix->Element[0], matrix->Element[0]+16);
+  key.push_back(viewPortRatio[0]);
+  key.push_back(viewPortRatio[1]);
+  key.push_back(X);
+  key.push_back(Y);
+  // MTimes are unique across objects, so they also tell a replaced input or array apart
+  key.push_back(indo ? static_cast<double>(indo->GetMTime()) : -1.0);
+  key.push_back(scalars ? static_cast<double>(scalars->GetMTime()) : -1.0);
+  key.push_back(this->Compositor->GetCompositingMode());
+  key.push_back(this->Compositor->GetPrecision());
+  key.push_back(TypeArray ? static_cast<double>(TypeArray->GetMTime()) : -1.0);
+  key.push_back(ActiveArray ? static_cast<double>(ActiveArray->GetMTime()) : -1.0);
+  key.insert(key.end(), this->TypeActive.begin(), this->TypeActive.end());
+  key.push_back(splatting ? static_cast<double>(RadiusArray->GetMTime()) : -1.0);
+  key.push_back(splatting ? splat.Kernel : -1);
+  key.push_back(op);
+  key.push_back(WeightArray ? static_cast<double>(WeightArray->GetMTime()) : -1.0);
+  key.push_back(picking ? 1.0 : 0.0);
+  std::vector<vtkMIPBlock> blocks;
+  if (composite) {
+    this->GetBlocks(composite, blocks, key);
   }
-  
+  int changed = (key!=this->MIPImageKey) ? 1 : 0;
   //
-  // array of final MIP values, one per pixel of final image
+  // the statistics of this frame, all but the bounds time are per frame
   //
-  std::vector<double> mipValues(X*Y, VTK_DOUBLE_MIN);
-  //
-  // transform all points from world coordinates into viewport positions
-  //
-  int C = scalars ? scalars->GetNumberOfComponents() : 1;
-#pragma omp parallel for  
-  for (vtkIdType i=0; i<N; i++) {
-    // for openmp, disable activeparticles
-    // what particle type is this
-    int ptype = 0; // TypeArray ? TypeArray->GetTuple1(i) : 0;
-    // clamp it to prevent array access faults
-    // ptype = ptype<this->NumberOfParticleTypes ? ptype : 0;
+  double *stats = this->LocalStatistics;
+  double boundsTime = stats[BOUNDS_TIME];
+  std::fill(stats, stats+NUMBER_OF_STATISTICS, 0.0);
+  stats[BOUNDS_TIME] = boundsTime;
+  this->Compositor->ResetBytesSent();
+  // a subsampled image is refined on every frame with the same camera
+  // until it is complete (the view decides when frames are drawn)
+  int dirty = changed || (subsampleLOD &&
+    this->SubsampleDrawn<static_cast<vtkIdType>(this->Subsample->Values.size()));
+  if (this->Controller->GetNumberOfProcesses()>1) {
+    int localDirty = dirty;
+    this->Controller->AllReduce(&localDirty, &dirty, 1, vtkCommunicator::MAX_OP);
+  }
+  if (dirty) {
+    //
+    // watch out, if one process has no points, pts array will be NULL
+    //
+    vtkIdType N = pts ? pts->GetNumberOfPoints() : 0;
+    float *pointsF = NULL;
+    double *pointsD = NULL;
+    if (N>0) {
+      vtkMIP_FloatOrDoubleArrayPointer(pts->GetData(), pointsF, pointsD);
+    }
     
-    // is this particle active, if not skip it
-//    bool active = this->TypeActive[ptype] && (ActiveArray ? (ActiveArray->GetTuple1(i)!=0) : 1);
-//    if (!active) continue;
-
-    // if we are active, transform the point and do the mip comparison
     //
-    double p[3];
-    if (pointsF) {
-      p[0] = pointsF[i*3+0];
-      p[1] = pointsF[i*3+1];
-      p[2] = pointsF[i*3+2];
+    // transform all points from world coordinates into viewport positions
+    // and keep the max value per pixel
+    //
+    MIPView view;
+    memcpy(view.Matrix, matrix->Element, sizeof(view.Matrix));
+    view.ViewPortRatio[0] = viewPortRatio[0];
+    view.ViewPortRatio[1] = viewPortRatio[1];
+    view.Size[0] = X;
+    view.Size[1] = Y;
+    view.TileBinning = (this->TileBinning!=0);
+    view.Operator = mean ? MIP_OPERATOR_SUM : op;
+    const double empty = MIPOperatorEmpty(view.Operator);
+    //
+    // array of final MIP values, one per pixel of final image, and for the
+    // mean the weights (or counts) it is divided by. They are only
+    // reallocated when the viewport changes
+    //
+    MIPFrameBuffers &buffers = *this->FrameBuffers;
+    if (!subsampleLOD) {
+      buffers.Values.Reset(X*Y, empty);
+    }
+    else if (changed || this->SubsampleImage.size()!=static_cast<size_t>(X*Y)) {
+      // the refinement restarts from an empty image
+      this->SubsampleImage.assign(X*Y, empty);
+      this->SubsampleDrawn = 0;
+    }
+    if (mean) {
+      buffers.Weights.Reset(X*Y, 0.0);
     }
     else {
-      p[0] = pointsD[i*3+0];
-      p[1] = pointsD[i*3+1];
-      p[2] = pointsD[i*3+2];
-    }
-
-    double view[4], pos[2];
-    // convert from world to view
-    view[0] = p[0]*matrix->Element[0][0] + p[1]*matrix->Element[0][1] +
-      p[2]*matrix->Element[0][2] + matrix->Element[0][3];
-    view[1] = p[0]*matrix->Element[1][0] + p[1]*matrix->Element[1][1] +
-      p[2]*matrix->Element[1][2] + matrix->Element[1][3];
-    view[2] = p[0]*matrix->Element[2][0] + p[1]*matrix->Element[2][1] +
-      p[2]*matrix->Element[2][2] + matrix->Element[2][3];
-    view[3] = p[0]*matrix->Element[3][0] + p[1]*matrix->Element[3][1] +
-      p[2]*matrix->Element[3][2] + matrix->Element[3][3];
-    if (view[3] != 0.0) {
-      pos[0] = view[0]/view[3];
-      pos[1] = view[1]/view[3];
-    }
-
-    int ix = static_cast<int>((pos[0] + 1.0) * viewPortRatio[0] + 0.5);
-    int iy = static_cast<int>((pos[1] + 1.0) * viewPortRatio[1] + 0.5);
-    double tuple[12]; // max tensor arrays size?
-    bool magnitude = (C>1);
-    double mip;
-    
-    // plot the point if it exceeds the previous max value at that pixel
-    if (ix>=0 && ix<X && iy>=0 && iy<Y) {
-      if (scalars && !magnitude) {
-        scalars->GetTuple(i,tuple);
-        mip = mipValues[ix + iy*X];
+      buffers.Weights.Release();
+      buffers.CollectedWeights.Release();
+    }
+    if (subsampleLOD) {
+      buffers.Values.Release();
+    }
+    double *localImage = subsampleLOD ? &this->SubsampleImage[0] : buffers.Values.GetData();
+    if (!spatialCulling && !this->SpatialTreeKey.empty()) {
+      // release the tree
+      *this->SpatialTree = MIPTree();
+      this->SpatialTreeKey.clear();
+    }
+    if (!subsampleLOD && !this->SubsampleKey.empty()) {
+      *this->Subsample = MIPSubsample();
+      this->SubsampleKey.clear();
+      std::vector<double>().swap(this->SubsampleImage);
+    }
+    this->Compositor->SetController(this->Controller);
+    this->Compositor->SetOperator(view.Operator);
+    // every pixel is written by the compositing
+    buffers.Collected.Allocate(X*Y, empty);
+    double *collected = buffers.Collected.GetData();
+    if (pipelined) {
+      this->Compositor->BeginBands(localImage, collected, X, Y);
+    }
+    double projectStart = vtkTimerLog::GetUniversalTime();
+    if (composite) {
+      //
+      // all the leaves are drawn into the one local image, in parallel, so
+      // the frame has a single compositing step
+      //
+      vtkMIP_ProjectBlocks(view, blocks, false, this->ScalarCache, localImage);
+      if (mean) {
+        MIPView weightView = view;
+        weightView.Operator = MIP_OPERATOR_SUM;
+        vtkMIP_ProjectBlocks(weightView, blocks, true, this->ScalarCache,
+          buffers.Weights.GetData());
       }
-      else if (scalars && magnitude) {
-        scalars->GetTuple(i,tuple);
-        tuple[0] = vtkMath::Norm(tuple,C);
-        mip = mipValues[ix + iy*X];
+      for (size_t b=0; b<blocks.size(); b++) {
+        stats[PARTICLES] += static_cast<double>(blocks[b].N);
       }
-      else { 
-        tuple[0] = 0;
+    }
+    else if (N>0 && FloatOrDoubleSet(pointsF, pointsD)) {
+      //
+      // only the particles of the active types (and with a non zero active
+      // flag) are drawn, they are found through an index sorted by type
+      // which is rebuilt when the type or active arrays change.
+      //
+      this->UpdateTypePartition(TypeArray, ActiveArray, N);
+      if (subsampleLOD) {
+        //
+        // draw the next particles of the shuffled copy, as many as fit
+        // in the frame budget at the projection rate measured so far.
+        //
+        if (this->UpdateSubsample(pts, scalars, N)) {
+          std::fill(this->SubsampleImage.begin(), this->SubsampleImage.end(), empty);
+          this->SubsampleDrawn = 0;
+        }
+        vtkIdType total = static_cast<vtkIdType>(this->Subsample->Values.size());
+        vtkIdType count = (this->ProjectionRate>0.0) ?
+          static_cast<vtkIdType>(this->FrameBudget*this->ProjectionRate) : (1<<20);
+        count = std::min(std::max<vtkIdType>(count, 65536), total-this->SubsampleDrawn);
+        if (count>0) {
+          vtkIdType first = this->SubsampleDrawn;
+          double start = vtkTimerLog::GetUniversalTime();
+          if (!this->Subsample->PointsF.empty()) {
+            MIPProjectPoints(view, &this->Subsample->PointsF[first*3],
+              &this->Subsample->Values[first], 1, count, localImage);
+          }
+          else {
+            MIPProjectPoints(view, &this->Subsample->PointsD[first*3],
+              &this->Subsample->Values[first], 1, count, localImage);
+          }
+          double elapsed = vtkTimerLog::GetUniversalTime() - start;
+          if (elapsed>0.0) {
+            double rate = count/elapsed;
+            this->ProjectionRate = (this->ProjectionRate>0.0) ?
+              0.5*(this->ProjectionRate + rate) : rate;
+          }
+          this->SubsampleDrawn += count;
+          stats[PARTICLES] = static_cast<double>(count);
+        }
+      }
+      else if (spatialCulling) {
+        //
+        // skip the parts of the k-d tree outside the view, or hidden
+        // behind higher values already drawn.
+        //
+        this->UpdateSpatialTree(pts, scalars, N);
+        MIPProjectTree(view, *this->SpatialTree, localImage);
+        stats[PARTICLES] = static_cast<double>(N);
       }
-      if (tuple[0]>mip) {
-        mipValues[ix + iy*X] = tuple[0];
+      else {
+        //
+        // for a weighted mean the values are premultiplied by the weights
+        // (cached until either changes), then the weights are summed
+        // separately, or the particles counted
+        //
+        vtkDataArray *values = WeightArray ?
+          this->ScalarCache->GetWeighted(scalars, WeightArray) : scalars;
+        //
+        // when pipelining, each band of the image is handed to the compositor
+        // as soon as it is final. That needs all particles in one call, and
+        // MPI calls from within the OpenMP region (see GetBandsOverlap)
+        //
+        MIPView drawView = view;
+        vtkMIPRanges ranges;
+        vtkMIP_ActiveRanges(this->TypePartition, this->TypeActive, ranges);
+        if (pipelined && ranges.size()==1 && this->Compositor->GetBandsOverlap()) {
+          drawView.BandCallback = vtkMIPCompositor::BandCallback;
+          drawView.BandData     = this->Compositor;
+        }
+        if (pointsF) {
+          vtkMIP_ProjectActiveTypes(drawView, pointsF, N, this->TypePartition, this->TypeActive,
+            values, this->ScalarCache, splatting, NULL, localImage);
+        }
+        else {
+          vtkMIP_ProjectActiveTypes(drawView, pointsD, N, this->TypePartition, this->TypeActive,
+            values, this->ScalarCache, splatting, NULL, localImage);
+        }
+        if (mean) {
+          MIPView weightView = view;
+          weightView.Operator = WeightArray ? MIP_OPERATOR_SUM : MIP_OPERATOR_COUNT;
+          if (pointsF) {
+            vtkMIP_ProjectActiveTypes(weightView, pointsF, N, this->TypePartition,
+              this->TypeActive, WeightArray, this->ScalarCache, splatting, NULL,
+              buffers.Weights.GetData());
+          }
+          else {
+            vtkMIP_ProjectActiveTypes(weightView, pointsD, N, this->TypePartition,
+              this->TypeActive, WeightArray, this->ScalarCache, splatting, NULL,
+              buffers.Weights.GetData());
+          }
+        }
+        stats[PARTICLES] = static_cast<double>(N);
       }
     }
-  }
-
-  //
-  // Now Gather results from all processes and perform the Max (or other) operation
-  //
-  std::vector<double> mipCollected(X*Y, VTK_DOUBLE_MIN);
-  this->Controller->Reduce(&mipValues[0], &mipCollected[0]/*(double*)MPI_IN_PLACE*/, X*Y, vtkCommunicator::MAX_OP, 0);
-
-  //
-  // only convert to colours on master process
-  //
-  if (this->Controller->GetLocalProcessId()==0) {
+    this->ProjectionTime = vtkTimerLog::GetUniversalTime() - projectStart;
     //
-    // create an RGB image buffer
+    // for picking, find the particle each pixel of the local image came from
+    // in a second pass over the drawn particles, then record its global id,
+    // process and depth
     //
-//    std::vector< RGB_tuple<float> > mipImage(X*Y, RGB_tuple<float>(0,0,0));
+    MIPPickImage &pickImage = *this->PickImage;
+    if (picking) {
+      pickImage.Size[0] = X;
+      pickImage.Size[1] = Y;
+      pickImage.Records.resize(X*Y);
+      pickImage.Winners.assign(X*Y, -1);
+      vtkMIPPick pick = { localImage, &pickImage.Winners[0] };
+      int prank = this->Controller->GetLocalProcessId();
+      if (composite) {
+        //
+        // the winners of each block are merged in as if they came from
+        // another process, ties going to the lowest particle number
+        //
+        MIPMakePickRecords(view, static_cast<const double*>(NULL), localImage,
+          &pickImage.Winners[0], prank, X*Y, &pickImage.Records[0]);
+        std::vector<MIPPickRecord> blockRecords(blocks.empty() ? 0 : X*Y);
+        for (size_t b=0; b<blocks.size(); b++) {
+          const vtkMIPBlock &block = blocks[b];
+          std::fill(pickImage.Winners.begin(), pickImage.Winners.end(), -1);
+          if (block.PointsF) {
+            vtkMIP_ProjectPoints(view, block.PointsF, NULL, block.N, block.Values,
+              this->ScalarCache, NULL, &pick, NULL);
+            MIPMakePickRecords(view, block.PointsF, localImage, &pickImage.Winners[0],
+              prank, X*Y, &blockRecords[0]);
+          }
+          else {
+            vtkMIP_ProjectPoints(view, block.PointsD, NULL, block.N, block.Values,
+              this->ScalarCache, NULL, &pick, NULL);
+            MIPMakePickRecords(view, block.PointsD, localImage, &pickImage.Winners[0],
+              prank, X*Y, &blockRecords[0]);
+          }
+          vtkMIP_GlobalPickIds(block.Input, block.Offset, X*Y, &blockRecords[0]);
+          MIPMergePickRecords(&blockRecords[0], X*Y, op, &pickImage.Records[0]);
+        }
+      }
+      else if (N>0 && pointsF) {
+        vtkMIP_ProjectActiveTypes(view, pointsF, N, this->TypePartition, this->TypeActive,
+          scalars, this->ScalarCache, NULL, &pick, NULL);
+        MIPMakePickRecords(view, pointsF, localImage, &pickImage.Winners[0], prank,
+          X*Y, &pickImage.Records[0]);
+      }
+      else if (N>0 && pointsD) {
+        vtkMIP_ProjectActiveTypes(view, pointsD, N, this->TypePartition, this->TypeActive,
+          scalars, this->ScalarCache, NULL, &pick, NULL);
+        MIPMakePickRecords(view, pointsD, localImage, &pickImage.Winners[0], prank,
+          X*Y, &pickImage.Records[0]);
+      }
+      else {
+        MIPMakePickRecords(view, static_cast<const double*>(NULL), localImage,
+          &pickImage.Winners[0], prank, X*Y, &pickImage.Records[0]);
+      }
+      if (input) {
+        vtkMIP_GlobalPickIds(input, 0, X*Y, &pickImage.Records[0]);
+      }
+    }
+    else {
+      pickImage = MIPPickImage();
+    }
+    stats[PROJECT_TIME]    = vtkTimerLog::GetUniversalTime() - projectStart;
+    stats[OCCUPIED_PIXELS] = static_cast<double>(MIPCountOccupied(localImage, X*Y, empty));
     //
-    // map mipped scalar values to RGB colours using lookuptable
-    // we do one lookup per final pixel, except empty pixels
+    // report the projection rate, separately for Z-order sorted input
+    // (see vtkMIPMortonSort) so the gain of sorting can be read off
     //
-    RGB_tuple<double> background;
-    RGB_tuple<unsigned char> backgroundchar;
-    ren->GetBackground(&background.r);
-    if (vtkColorTransferFunction::SafeDownCast(s2c)) {
-      vtkColorTransferFunction::SafeDownCast(s2c)->SetNanColor(&background.r);
-    }
-    backgroundchar.r = static_cast<unsigned char>(background.r*255.0 +0.5);
-    backgroundchar.g = static_cast<unsigned char>(background.g*255.0 +0.5);
-    backgroundchar.b = static_cast<unsigned char>(background.b*255.0 +0.5);
-
-//#define LUT_METHOD 1
-#define OLD_METHOD 1
-#ifdef LUT_METHOD
-    double nan = vtkMath::Nan();
-#pragma omp parallel for  
-    for (int ix=0; ix<X; ix++) {
-      for (int iy=0; iy<Y; iy++) {
-        double pixval = mipCollected[ix + iy*X];
-        if (pixval==VTK_DOUBLE_MIN) {
-          mipCollected[ix + iy*X] = nan;
-        }
+    const double particles = stats[PARTICLES];
+    if (particles>0.0 && this->ProjectionTime>0.0 && !subsampleLOD && !spatialCulling) {
+      // the sort tags every leaf of a composite input, all must be sorted
+      int ordered = composite ? !blocks.empty() : vtkMIP_MortonOrdered(input);
+      for (size_t b=0; b<blocks.size(); b++) {
+        ordered = ordered && vtkMIP_MortonOrdered(blocks[b].Input);
       }
+      this->OrderedRates[ordered] = particles/this->ProjectionTime;
+      stats[MORTON_ORDERED] = ordered;
+      stats[PROJECT_RATE]   = this->OrderedRates[ordered];
+      vtkDebugMacro(<< "Projected " << particles << " particles"
+        << (ordered ? " (Morton ordered)" : "") << " in "
+        << this->ProjectionTime*1000.0 << " ms, "
+        << this->OrderedRates[ordered]/1.0e6 << " Mparticles/s");
+    }
+    if (this->OrderedRates[0]>0.0 && this->OrderedRates[1]>0.0) {
+      stats[MORTON_SPEEDUP] = this->OrderedRates[1]/this->OrderedRates[0];
     }
-    std::vector< RGB_tuple<unsigned char> > mipImageChar(X*Y, RGB_tuple<unsigned char>(0,0,0));
-    s2c->MapScalarsThroughTable2(&mipCollected[0], 
-                                 &mipImageChar[0].r,
-                                 VTK_DOUBLE, 
-                                 X*Y,
-                                 1,
-                                 VTK_RGB);
-#endif
 
-#ifdef OLD_METHOD
-    std::vector< RGB_tuple<unsigned char> > mipImageChar(X*Y, RGB_tuple<unsigned char>(0,0,0));
-    // call before entering openMP block to ensure thread safe build first time
-    s2c->Build();
-#pragma omp parallel for  
-    for (int ix=0; ix<X; ix++) {
-      for (int iy=0; iy<Y; iy++) {
-        double pixval = mipCollected[ix + iy*X];
-        RGB_tuple<unsigned char> &rgbVal = mipImageChar[ix + iy*X];
-        //
-        if (pixval==VTK_DOUBLE_MIN) {
-          rgbVal.r = backgroundchar.r;
-          rgbVal.g = backgroundchar.g;
-          rgbVal.b = backgroundchar.b;
-        }
-        else {
-          // @TODO : MapValue appears to be thread safe if s2c is a vtkDiscretizableColorTransferFunction
-          unsigned char *rgba = s2c->MapValue(pixval);
-          rgbVal.r = rgba[0];
-          rgbVal.g = rgba[1];
-          rgbVal.b = rgba[2];
-/*
-          // @TODO : not sure that MapValue is thread safe
-          double rgb[3];
-          s2c->vtkScalarsToColors::GetColor(pixval, rgb);
-          rgbVal.r = static_cast<unsigned char>(rgb[0]*255 + 0.5);
-          rgbVal.g = static_cast<unsigned char>(rgb[1]*255 + 0.5);
-          rgbVal.b = static_cast<unsigned char>(rgb[2]*255 + 0.5);
-*/
-        }
-      }
+    //
+    // Now Gather results from all processes and perform the Max (or other)
+    // operation, then mark the pixels nothing was drawn onto as empty for
+    // the colour mapping
+    //
+    double compositeStart = vtkTimerLog::GetUniversalTime();
+    if (pipelined) {
+      // start the bands nothing was drawn into and wait for all of them
+      this->Compositor->EndBands();
     }
-#endif
+    else {
+      this->Compositor->Composite(localImage, collected, X, Y);
+    }
+    if (picking) {
+      this->Compositor->CompositePickRecords(&pickImage.Records[0], X, Y);
+    }
+    vtkIdType range[2];
+    this->Compositor->GetOwnedPixels(range);
+    if (mean) {
+      buffers.CollectedWeights.Allocate(X*Y, 0.0);
+      double *weights = buffers.CollectedWeights.GetData();
+      this->Compositor->Composite(buffers.Weights.GetData(), weights, X, Y);
+      MIPMeanImage(&collected[range[0]], &weights[range[0]], range[1]-range[0]);
+    }
+    else {
+      MIPFinalizeImage(&collected[range[0]], range[1]-range[0], op);
+    }
+    this->MIPImageKey.swap(key);
+    stats[COMPOSITE_TIME] = vtkTimerLog::GetUniversalTime() - compositeStart;
+  }
+  const double *mipCollected = this->FrameBuffers->Collected.GetData();
+
+  //
+  // convert to colours the pixels this process holds the final values of,
+  // that is the whole image on the master process unless the compositing
+  // left each process with a strip of it.
+  //
+  vtkIdType owned[2];
+  this->Compositor->GetOwnedPixels(owned);
+  int rank = this->Controller->GetLocalProcessId();
+  //
+  // map mipped scalar values to RGB colours through a table sampled from the
+  // lookuptable, the table is only rebuilt when the lookuptable changes.
+  //
+  double background[3];
+  ren->GetBackground(background);
+  unsigned char backgroundchar[4];
+  backgroundchar[0] = static_cast<unsigned char>(background[0]*255.0 +0.5);
+  backgroundchar[1] = static_cast<unsigned char>(background[1]*255.0 +0.5);
+  backgroundchar[2] = static_cast<unsigned char>(background[2]*255.0 +0.5);
+  backgroundchar[3] = 255;
+  double colourStart = vtkTimerLog::GetUniversalTime();
+  this->UpdateColourTable(s2c);
+  // the master process needs the full image for drawing, the others only their strip
+  vtkIdType nowned = owned[1]-owned[0];
+  // every pixel is written by the colour mapping or the gather
+  MIPBuffer<unsigned char> &colours = this->FrameBuffers->Colours;
+  colours.Allocate(3*std::max<vtkIdType>(rank==0 ? X*Y : nowned, 1), 0);
+  RGB_tuple<unsigned char> *mipImageChar =
+    reinterpret_cast< RGB_tuple<unsigned char>* >(colours.GetData());
+  RGB_tuple<unsigned char> *strip = &mipImageChar[rank==0 ? owned[0] : 0];
+  if (nowned>0) {
+    MIPColourMapImage(&mipCollected[owned[0]], nowned, *this->ColourTable,
+      backgroundchar, 3, &strip->r);
+  }
+  this->Compositor->GatherColours(&strip->r, &mipImageChar[0].r, X, Y, 3);
+  stats[COLOUR_TIME] = vtkTimerLog::GetUniversalTime() - colourStart;
+  //
+  // only draw on master process
+  //
+  if (rank==0) {
+    double drawStart = vtkTimerLog::GetUniversalTime();
     //
     // copy to OpenGL image buffer
     //
@@ -511,20 +1486,16 @@ void vtkMIPPainter::Render(vtkRenderer* ren, vtkActor* actor,
     // so all other geometry will appear in front of it.
     glRasterPos3f(0, 0, -0.99);
 
-#ifdef OLD_METHOD
-    unsigned char *xx0 = &mipImageChar[0].r;    
-    glDrawPixels(X, Y, (GLenum)(GL_RGB), (GLenum)(GL_UNSIGNED_BYTE), (GLvoid*)(xx0));
-#endif
-
-#ifdef LUT_METHOD
     unsigned char *xx0 = &mipImageChar[0].r;    
     glDrawPixels(X, Y, (GLenum)(GL_RGB), (GLenum)(GL_UNSIGNED_BYTE), (GLvoid*)(xx0));
-#endif
 
     glMatrixMode( GL_MODELVIEW );   
     glPopMatrix();
     glMatrixMode( GL_PROJECTION );
     glPopMatrix();
+    stats[DRAW_TIME] = vtkTimerLog::GetUniversalTime() - drawStart;
   }
+  stats[BYTES_SENT] = static_cast<double>(this->Compositor->GetBytesSent());
+  this->GatherFrameStatistics();
 }
 
@@ -14,6 +14,13 @@
 =========================================================================*/
 // .NAME vtkMIPPainter - vtkMIP.
 // .SECTION Description
+// The input is a point set, or a composite dataset whose point set leaves
+// (e.g. one block per species or file) are all drawn into one image, so
+// that a frame has a single compositing step whatever the number of
+// blocks. For composite inputs each leaf is a particle type, numbered in
+// traversal order (empty leaves included), and SetTypeActive shows/hides
+// whole leaves; TypeScalars, ActiveScalars, SpatialCulling and SubsampleLOD
+// are not used.
 // .SECTION Implementation
 //
 // .SECTION See Also
@@ -28,6 +35,19 @@
 
 class vtkMultiProcessController;
 class vtkScalarsToColorsPainter;
+class vtkMIPScalarCache;
+class vtkMIPCompositor;
+class vtkScalarsToColors;
+class vtkDataArray;
+struct MIPColourTable;
+struct MIPTypePartition;
+struct MIPTree;
+struct MIPSubsample;
+struct MIPPickImage;
+struct MIPFrameBuffers;
+struct vtkMIPBlock;
+class vtkCompositeDataSet;
+class vtkPoints;
 
 class VTK_EXPORT vtkMIPPainter : public vtkPolyDataPainter
 {
@@ -53,6 +73,31 @@ public:
   vtkSetStringMacro(ActiveScalars);
   vtkGetStringMacro(ActiveScalars);
 
+  // Description:
+  // SPH particles have a smoothing length, when this names a (float or
+  // double) point array each particle is splatted over the disc its
+  // sphere of that radius projects to, weighted by SplatKernel
+  // (0=top hat, 1=cubic spline, 2=gaussian, see MIPSplat).
+  // Spatial culling and the subsample LOD are not used while splatting.
+  vtkSetStringMacro(RadiusScalars);
+  vtkGetStringMacro(RadiusScalars);
+  vtkSetClampMacro(SplatKernel, int, 0, 2);
+  vtkGetMacro(SplatKernel, int);
+
+  // Description:
+  // How the values of the particles falling on a pixel are combined
+  // (0=max, 1=min, 2=sum, 3=mean, 4=count, see MIPOperator), max by default.
+  // The mean is the sum of the values divided by the number of particles,
+  // or with WeightScalars set the WeightScalars weighted mean (e.g. mass
+  // weighted temperature), it costs two projections and compositings.
+  // The leaves of a composite input without WeightScalars are counted.
+  // Occlusion culling only applies to the max, the k-d tree is not used
+  // for means and the subsample LOD only for max and min.
+  vtkSetClampMacro(Operator, int, 0, 4);
+  vtkGetMacro(Operator, int);
+  vtkSetStringMacro(WeightScalars);
+  vtkGetStringMacro(WeightScalars);
+
   // Description:
   // There may be N particle types. Each type has its own colour table,
   // Intensity array, brigthness etc. The remaining values are defined per
@@ -74,6 +119,13 @@ public:
   virtual void SetScalarsToColorsPainter(vtkScalarsToColorsPainter* ScalarsToColorsPainter);
   vtkGetObjectMacro(ScalarsToColorsPainter, vtkScalarsToColorsPainter);
 
+  // Description:
+  // Values derived from the scalars (magnitudes of vector arrays) are kept
+  // in this cache between frames. The representation shares one cache
+  // between its full resolution and LOD painters.
+  virtual void SetScalarCache(vtkMIPScalarCache* cache);
+  vtkGetObjectMacro(ScalarCache, vtkMIPScalarCache);
+
 //BTX
   // Description:
   // Set/Get the controller used for coordinating parallel writing
@@ -94,10 +146,113 @@ public:
   vtkSetVector2Macro(ScalarRange,double);
   vtkSetMacro(UseLookupTableScalarRange,int);
 
+  // Description:
+  // Encoding used when the images of all processes are reduced,
+  // see vtkMIPCompositor (0=double, 1=float, 2=16 bit quantized).
+  void SetReductionPrecision(int precision);
+  int  GetReductionPrecision();
+
+  // Description:
+  // How the images of all processes are combined, see vtkMIPCompositor
+  // (0=dense reduce, 1=sparse, 2=binary swap, 3=pipelined). The pipelined
+  // mode projects via screen tiles (see TileBinning) and reduces each band
+  // of the image while the next ones are drawn. It is not used with
+  // splats, spatial culling, the subsample LOD or means.
+  void SetCompositingMode(int mode);
+  int  GetCompositingMode();
+
+  // Description:
+  // When on, a k-d tree with the max scalar of every node is built over the
+  // local particles (once per data change) and the parts of it outside the
+  // view, or which cannot beat the pixels already drawn, are skipped.
+  // Worthwhile when zooming into large datasets. Off by default.
+  vtkSetMacro(SpatialCulling, int);
+  vtkGetMacro(SpatialCulling, int);
+
+  // Description:
+  // When on, the projected particles are first binned into screen tiles
+  // and each tile is then max-reduced on its own, trading a second pass
+  // over the particles for cache resident, atomic free image writes.
+  // Pays off for very large images on many-core nodes. Off by default.
+  vtkSetMacro(TileBinning, int);
+  vtkGetMacro(TileBinning, int);
+
+  // Description:
+  // When on, the particles are drawn from a copy shuffled in a fixed random
+  // order, each frame draws as many of the next ones as fit in FrameBudget
+  // (seconds) on top of the previous frame's image, as long as the camera
+  // and data do not change. A moving camera thus shows a stable random
+  // subsample, which grows on every render with the same camera. The
+  // painter does not ask for these renders itself (a render must happen on
+  // all processes at once), so the view only delivers the budgeted prefix
+  // unless it renders the LOD again.
+  // Used by the representation for the LOD painter.
+  vtkSetMacro(SubsampleLOD, int);
+  vtkGetMacro(SubsampleLOD, int);
+  vtkSetMacro(FrameBudget, double);
+  vtkGetMacro(FrameBudget, double);
+
+  // Description:
+  // When on, every max or min image also records which particle each pixel
+  // came from (global id if the input has global ids, process and depth,
+  // see MIPPick), so that GetPickedParticle answers without re-rendering.
+  // Costs a second pass over the particles and a reduction of 24 bytes per
+  // covered pixel. Not available while splatting or with the subsample LOD.
+  // Off by default.
+  vtkSetMacro(PickBuffers, int);
+  vtkGetMacro(PickBuffers, int);
+
+  // Description:
+  // The particle drawn at pixel (x,y) of the last image (origin at the
+  // bottom left, as drawn), its window depth in [0,1] and its value.
+  // Returns false for empty pixels or without PickBuffers. Only process 0
+  // holds the composited records.
+  bool GetPickedParticle(int x, int y, vtkIdType &id, int &process,
+    double &depth, double &value);
+
+  // Description:
+  // Wall time of the last local projection, in seconds.
+  vtkGetMacro(ProjectionTime, double);
+
+//BTX
+  // The statistics measured on every process for each frame
+  enum
+    {
+    PROJECT_TIME    = 0, // local projection (and pick pass), seconds
+    COMPOSITE_TIME  = 1, // compositing of the images (and pick records)
+    COLOUR_TIME     = 2, // colour mapping and gathering of the strips
+    DRAW_TIME       = 3, // issuing glDrawPixels, process 0 only
+    BOUNDS_TIME     = 4, // the last UpdateBounds
+    PARTICLES       = 5, // particles projected, 0 when the image is reused
+    BYTES_SENT      = 6, // bytes sent for compositing
+    OCCUPIED_PIXELS = 7, // non empty pixels of the local image
+    MORTON_ORDERED  = 8, // 1 when the projected particles were Z-order sorted
+    PROJECT_RATE    = 9, // particles per second of the projection, 0 if not measured
+    MORTON_SPEEDUP  = 10, // last sorted over last unsorted rate, 0 until both are known
+    NUMBER_OF_STATISTICS = 11
+    };
+//ETX
+
+  // Description:
+  // The min, max and average over processes of every statistic of the
+  // last frame, as 3*NUMBER_OF_STATISTICS values (min, max, avg of
+  // statistic 0, then of statistic 1...). Only valid on process 0.
+  // GetFrameStatisticsTime tells which of two painters rendered last.
+  const double *GetFrameStatistics() { return this->FrameStatistics; }
+  unsigned long GetFrameStatisticsTime() { return this->FrameStatisticsTime.GetMTime(); }
+  static const char *GetStatisticName(int s);
+
+  // Description:
+  // When set, process 0 appends the statistics of every frame as one line
+  // to this CSV file (written with a header line when the file is new).
+  vtkSetStringMacro(TimingLogFile);
+  vtkGetStringMacro(TimingLogFile);
+
   // Description:
   // The MIP painter must return the complete bounds of the whole dataset
   // not just the local 'piece', otherwise the compositing blanks out parts it thinks
-  // are not covered by any geometry.
+  // are not covered by any geometry. They are cached until the data changes.
+  // This is a collective call.
   void UpdateBounds(double bounds[6]);
 
 protected:
@@ -109,15 +264,110 @@ protected:
   // since the last time this method was called.
   virtual void ProcessInformation(vtkInformation*);
 
+  // Description:
+  // Sample the lookuptable into the colour table used to map pixels,
+  // if it changed since the last call.
+  void UpdateColourTable(vtkScalarsToColors *s2c);
+
+  // Description:
+  // Sort the particle ids by type, leaving out the inactive particles,
+  // if the type or active arrays changed since the last call.
+  void UpdateTypePartition(vtkDataArray *types, vtkDataArray *active, vtkIdType N);
+
+  // Description:
+  // Rebuild the k-d tree over the particles of the active types if the
+  // points, scalars or type selection changed since the last call.
+  void UpdateSpatialTree(vtkPoints *pts, vtkDataArray *scalars, vtkIdType N);
+
+  // Description:
+  // Rebuild the shuffled copy of the particles of the active types if the
+  // points, scalars or type selection changed, returns true if it did.
+  bool UpdateSubsample(vtkPoints *pts, vtkDataArray *scalars, vtkIdType N);
+
+  // Description:
+  // Collect the min/max/average over processes of LocalStatistics on
+  // process 0, and log them. This is a collective call.
+  void GatherFrameStatistics();
+
+  // Description:
+  // The point set leaves of a composite input that are drawn, with their
+  // arrays resolved, and the state they were resolved from appended to key.
+  void GetBlocks(vtkCompositeDataSet *input, std::vector<vtkMIPBlock> &blocks,
+    std::vector<double> &key);
+
+  // Description:
+  // The state the copies of the particles (tree, subsample) depend on.
+  void GetSelectionKey(vtkPoints *pts, vtkDataArray *scalars, std::vector<double> &key);
+
 //  virtual int FillInputPortInformation(int port, vtkInformation *info);
 
   char             *TypeScalars;
   char             *ActiveScalars;
+  char             *RadiusScalars;
+  int               SplatKernel;
+  int               Operator;
+  char             *WeightScalars;
   int               NumberOfParticleTypes;
   std::vector<int>  TypeActive;
 
   vtkMultiProcessController *Controller;
   vtkScalarsToColorsPainter *ScalarsToColorsPainter;
+  vtkMIPScalarCache         *ScalarCache;
+  vtkMIPCompositor          *Compositor;
+
+  // The global bounds and the data state they were reduced for
+  double              GlobalBounds[6];
+  std::vector<double> BoundsKey;
+
+  // The camera/data state the composited scalar image was made for, it is
+  // reused when only the colour mapping changes.
+  std::vector<double> MIPImageKey;
+  // The image buffers of a frame (local and composited values, weights of
+  // the mean, colours), kept until the viewport changes, see MIPBuffer
+  MIPFrameBuffers    *FrameBuffers;
+
+  // The lookuptable sampled for fast, thread safe pixel colour mapping
+  MIPColourTable *ColourTable;
+  unsigned long   ColourTableTime;
+
+  // The particle ids sorted by type, so that only the active types are walked
+  MIPTypePartition   *TypePartition;
+  std::vector<double> TypePartitionKey;
+
+  // The k-d tree used for culling, and the state it was built for
+  int                 SpatialCulling;
+  MIPTree            *SpatialTree;
+  std::vector<double> SpatialTreeKey;
+
+  // Project in two passes, via screen tiles
+  int                 TileBinning;
+
+  // The shuffled particles, the local image they are refined into and the
+  // number of particles it holds so far
+  int                 SubsampleLOD;
+  double              FrameBudget;
+  MIPSubsample       *Subsample;
+  std::vector<double> SubsampleKey;
+  std::vector<double> SubsampleImage;
+  vtkIdType           SubsampleDrawn;
+  // particles per second of the projection, measured on previous frames
+  double              ProjectionRate;
+  // time of the last projection, and the last rates measured on input in
+  // arbitrary [0] and Z-order [1] order
+  double              ProjectionTime;
+  double              OrderedRates[2];
+
+  // Statistics of this process for the current frame, over all processes
+  // for the last frame and the CSV log
+  double              LocalStatistics[NUMBER_OF_STATISTICS];
+  double              FrameStatistics[3*NUMBER_OF_STATISTICS];
+  vtkTimeStamp        FrameStatisticsTime;
+  vtkIdType           FrameNumber;
+  char               *TimingLogFile;
+
+  // Which particle won each pixel of the last image
+  int                 PickBuffers;
+  MIPPickImage       *PickImage;
 
   int ArrayAccessMode;
   int ArrayComponent;
@@ -15,44 +15,66 @@
 #include "vtkMIPRepresentation.h"
 #include "vtkMIPDefaultPainter.h"
 //
+#include <cstring>
 #include <sstream>
 //
 #include "vtkDataObject.h"
 #include "vtkDefaultPainter.h"
+#include "vtkMIPMapper.h"
 #include "vtkMIPPainter.h"
+#include "vtkMIPMortonSort.h"
+#include "vtkMIPScalarCache.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkPolyData.h"
 // we inherit changes to these filters from GeometryRepresentation
 #include "vtkPainterPolyDataMapper.h"
 #include "vtkPVCacheKeeper.h"
 #include "vtkPVUpdateSuppressor.h"
+#include "vtkPVRenderView.h"
+#include "vtkPVView.h"
 #include "vtkPVLODActor.h"
 #include "vtkQuadricClustering.h"
 
 vtkStandardNewMacro(vtkMIPRepresentation);
 //----------------------------------------------------------------------------
+// The array lists of the GUI send "None" when no array is chosen, the
+// painter expects NULL, it decides from the setting alone what to draw
+static const char *vtkMIPRepresentation_ArrayName(const char *s)
+{
+  if (!s || !s[0] || !strcmp(s, "None")) {
+    return NULL;
+  }
+  return s;
+}
+//----------------------------------------------------------------------------
 vtkMIPRepresentation::vtkMIPRepresentation()
 {
   this->MIPDefaultPainter    = vtkMIPDefaultPainter::New();
   this->LODMIPDefaultPainter = vtkMIPDefaultPainter::New();
+  this->MortonSort           = vtkMIPMortonSort::New();
   this->MIPPainter           = this->MIPDefaultPainter->GetMIPPainter();
   this->LODMIPPainter        = this->LODMIPDefaultPainter->GetMIPPainter();
   this->MIPPainter->Register(this);
   this->LODMIPPainter->Register(this);
+  // the LOD painter reuses the cached scalars of the full resolution one
+  this->LODMIPPainter->SetScalarCache(this->MIPPainter->GetScalarCache());
   this->ActiveParticleType   = 0;
+  this->LODMode              = 0;
   this->Representation       = POINTS;
   this->Settings             = vtkSmartPointer<vtkStringArray>::New();
+  this->Statistics           = vtkSmartPointer<vtkStringArray>::New();
   //
   // The default Painter based Mapper : vtkCompositePolyDataMapper2 does not
   // pass the ComputeBounds through to the individual painters, so our screenspace
   // compositing from IceT is not handled well. 
-  // Since we can't handle multiblock data anyway, use a PolyDataPainter mapper
+  // vtkMIPMapper takes composite data too but gets its bounds from the painter
   //
   this->Mapper->Delete();
   this->LODMapper->Delete();
-  this->Mapper = vtkPainterPolyDataMapper::New();
-  this->LODMapper = vtkPainterPolyDataMapper::New();
+  this->Mapper = vtkMIPMapper::New();
+  this->LODMapper = vtkMIPMapper::New();
   //
   this->SetupDefaults();
 }
@@ -61,6 +83,7 @@ vtkMIPRepresentation::~vtkMIPRepresentation()
 {
   this->MIPDefaultPainter->Delete();
   this->LODMIPDefaultPainter->Delete();
+  this->MortonSort->Delete();
   this->MIPPainter->Delete();
   this->LODMIPPainter->Delete();
 }
@@ -80,11 +103,15 @@ void vtkMIPRepresentation::SetupDefaults()
 //  this->DeliveryFilter->SetOutputDataType(VTK_POLY_DATA);
 //  this->LODDeliveryFilter->SetOutputDataType(VTK_POLY_DATA);
   this->Decimator->SetCopyCellData(0);
-  // We don't want the MultiBlockMaker as we don't support multiblock
-  // connect the GeometryFilter to the CacheKeeper and bypass multiblockmaker.
-  // The MIPDefaultPainter removes the composite painter from the painter chain
+  // We don't want the MultiBlockMaker, composite data passes through as it
+  // is (the sort runs per block) and the MIP painter draws all the blocks
+  // into one image. Connect the GeometryFilter to the CacheKeeper and bypass
+  // multiblockmaker. The MIPDefaultPainter removes the composite painter
+  // from the painter chain.
+  // The (optional) Z-order sort goes in between so its result is cached.
 
-  this->CacheKeeper->SetInputConnection(this->GeometryFilter->GetOutputPort());
+  this->MortonSort->SetInputConnection(this->GeometryFilter->GetOutputPort());
+  this->CacheKeeper->SetInputConnection(this->MortonSort->GetOutputPort());
 
   // Setup painters
   vtkPainterPolyDataMapper* painterMapper = vtkPainterPolyDataMapper::SafeDownCast(this->Mapper);
@@ -102,6 +129,7 @@ int vtkMIPRepresentation::FillInputPortInformation(int port,
   vtkInformation *info)
 {
   info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPointSet");
+  info->Append(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkCompositeDataSet");
   info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
   return 1;
 }
@@ -110,9 +138,31 @@ int vtkMIPRepresentation::FillInputPortInformation(int port,
 int vtkMIPRepresentation::RequestData(vtkInformation* request,
   vtkInformationVector** inputVector, vtkInformationVector* outputVector)
 {
+  //
+  // Polydata made of points only (e.g. from vtkMIPMappedParticleSource)
+  // is already what the painter draws, it skips the geometry extraction
+  // and goes to the (optional) sort and cache as it is, arrays included.
+  //
+  vtkPolyData *points = (inputVector[0]->GetNumberOfInformationObjects()==1) ?
+    vtkPolyData::GetData(inputVector[0], 0) : NULL;
+  bool passThrough = points && points->GetNumberOfLines()==0 &&
+    points->GetNumberOfPolys()==0 && points->GetNumberOfStrips()==0;
+  this->MortonSort->SetInputConnection(passThrough ?
+    this->GetInternalOutputPort() : this->GeometryFilter->GetOutputPort());
   return this->Superclass::RequestData(request, inputVector, outputVector);
 }
 
+//----------------------------------------------------------------------------
+int vtkMIPRepresentation::ProcessViewRequest(vtkInformationRequestKey* request_type,
+  vtkInformation* inInfo, vtkInformation* outInfo)
+{
+  if (this->LODMode==1 && request_type==vtkPVView::REQUEST_UPDATE_LOD()) {
+    // the LOD painter subsamples the particles itself, skip the decimator
+    vtkPVRenderView::SetPieceLOD(inInfo, this, this->CacheKeeper->GetOutputDataObject(0));
+    return 1;
+  }
+  return this->Superclass::ProcessViewRequest(request_type, inInfo, outInfo);
+}
 //----------------------------------------------------------------------------
 void vtkMIPRepresentation::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -149,6 +199,39 @@ vtkStringArray *vtkMIPRepresentation::GetActiveParticleSettings()
   return this->Settings;
 }
 //----------------------------------------------------------------------------
+vtkStringArray *vtkMIPRepresentation::GetFrameStatistics()
+{
+  this->Statistics->Initialize();
+  this->Statistics->SetNumberOfComponents(4);
+  this->Statistics->SetNumberOfTuples(vtkMIPPainter::NUMBER_OF_STATISTICS);
+  // the LOD painter draws while interacting
+  vtkMIPPainter *painter = this->MIPPainter;
+  if (this->LODMIPPainter && (!painter ||
+      this->LODMIPPainter->GetFrameStatisticsTime()>painter->GetFrameStatisticsTime())) {
+    painter = this->LODMIPPainter;
+  }
+  for (int s=0; s<vtkMIPPainter::NUMBER_OF_STATISTICS; s++) {
+    const double *stats = painter ? painter->GetFrameStatistics() : NULL;
+    this->Statistics->SetValue(4*s, vtkMIPPainter::GetStatisticName(s));
+    for (int c=0; c<3; c++) {
+      this->Statistics->SetValue(4*s+1+c,
+        NumToStr<double>(stats ? stats[3*s+c] : 0.0).c_str());
+    }
+  }
+  //
+  return this->Statistics;
+}
+//----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetTimingLogFile(const char *s)
+{
+  if (this->MIPPainter) this->MIPPainter->SetTimingLogFile(s);
+}
+//----------------------------------------------------------------------------
+const char *vtkMIPRepresentation::GetTimingLogFile()
+{
+  return this->MIPPainter->GetTimingLogFile();
+}
+//----------------------------------------------------------------------------
 void vtkMIPRepresentation::SetTypeActive(int l)
 {
   if (this->MIPPainter) this->MIPPainter->SetTypeActive(this->ActiveParticleType, l);
@@ -160,6 +243,130 @@ int vtkMIPRepresentation::GetTypeActive()
   return this->MIPPainter->GetTypeActive(this->ActiveParticleType);
 }
 //----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetReductionPrecision(int p)
+{
+  if (this->MIPPainter) this->MIPPainter->SetReductionPrecision(p);
+  if (this->LODMIPPainter) this->LODMIPPainter->SetReductionPrecision(p);
+}
+//----------------------------------------------------------------------------
+int vtkMIPRepresentation::GetReductionPrecision()
+{
+  return this->MIPPainter->GetReductionPrecision();
+}
+//----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetCompositingMode(int m)
+{
+  if (this->MIPPainter) this->MIPPainter->SetCompositingMode(m);
+  if (this->LODMIPPainter) this->LODMIPPainter->SetCompositingMode(m);
+}
+//----------------------------------------------------------------------------
+int vtkMIPRepresentation::GetCompositingMode()
+{
+  return this->MIPPainter->GetCompositingMode();
+}
+//----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetSpatialCulling(int c)
+{
+  if (this->MIPPainter) this->MIPPainter->SetSpatialCulling(c);
+  if (this->LODMIPPainter) this->LODMIPPainter->SetSpatialCulling(c);
+}
+//----------------------------------------------------------------------------
+int vtkMIPRepresentation::GetSpatialCulling()
+{
+  return this->MIPPainter->GetSpatialCulling();
+}
+//----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetTileBinning(int b)
+{
+  if (this->MIPPainter) this->MIPPainter->SetTileBinning(b);
+  if (this->LODMIPPainter) this->LODMIPPainter->SetTileBinning(b);
+}
+//----------------------------------------------------------------------------
+int vtkMIPRepresentation::GetTileBinning()
+{
+  return this->MIPPainter->GetTileBinning();
+}
+//----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetPickBuffers(int p)
+{
+  // the LOD painter draws while interacting, picks are made on still images
+  if (this->MIPPainter) this->MIPPainter->SetPickBuffers(p);
+}
+//----------------------------------------------------------------------------
+int vtkMIPRepresentation::GetPickBuffers()
+{
+  return this->MIPPainter->GetPickBuffers();
+}
+//----------------------------------------------------------------------------
+vtkIdType vtkMIPRepresentation::GetPickedPointId(int x, int y)
+{
+  vtkIdType id;
+  int process;
+  double depth, value;
+  if (!this->MIPPainter ||
+      !this->MIPPainter->GetPickedParticle(x, y, id, process, depth, value)) {
+    return -1;
+  }
+  return id;
+}
+//----------------------------------------------------------------------------
+int vtkMIPRepresentation::GetPickedProcessId(int x, int y)
+{
+  vtkIdType id;
+  int process;
+  double depth, value;
+  if (!this->MIPPainter ||
+      !this->MIPPainter->GetPickedParticle(x, y, id, process, depth, value)) {
+    return -1;
+  }
+  return process;
+}
+//----------------------------------------------------------------------------
+double vtkMIPRepresentation::GetPickedDepth(int x, int y)
+{
+  vtkIdType id;
+  int process;
+  double depth, value;
+  if (!this->MIPPainter ||
+      !this->MIPPainter->GetPickedParticle(x, y, id, process, depth, value)) {
+    return 1.0;
+  }
+  return depth;
+}
+//----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetLODMode(int m)
+{
+  if (m!=this->LODMode) {
+    this->LODMode = m;
+    if (this->LODMIPPainter) this->LODMIPPainter->SetSubsampleLOD(m==1);
+    // the view must fetch new LOD data
+    this->MarkModified();
+  }
+}
+//----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetMortonOrder(int m)
+{
+  if (m!=this->MortonSort->GetEnabled()) {
+    this->MortonSort->SetEnabled(m);
+    this->MarkModified();
+  }
+}
+//----------------------------------------------------------------------------
+int vtkMIPRepresentation::GetMortonOrder()
+{
+  return this->MortonSort->GetEnabled();
+}
+//----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetLODFrameBudget(double ms)
+{
+  if (this->LODMIPPainter) this->LODMIPPainter->SetFrameBudget(ms/1000.0);
+}
+//----------------------------------------------------------------------------
+double vtkMIPRepresentation::GetLODFrameBudget()
+{
+  return this->LODMIPPainter->GetFrameBudget()*1000.0;
+}
+//----------------------------------------------------------------------------
 /*
 void vtkMIPRepresentation::SetInputArrayToProcess(
   int idx, int port, int connection, int fieldAssociation, const char *name)
@@ -196,6 +403,54 @@ const char *vtkMIPRepresentation::GetActiveScalars()
   return NULL;
 }
 //----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetRadiusScalars(const char *s)
+{
+  s = vtkMIPRepresentation_ArrayName(s);
+  if (this->MIPPainter) this->MIPPainter->SetRadiusScalars(s);
+  if (this->LODMIPPainter) this->LODMIPPainter->SetRadiusScalars(s);
+}
+//----------------------------------------------------------------------------
+const char *vtkMIPRepresentation::GetRadiusScalars()
+{
+  if (this->MIPPainter) return this->MIPPainter->GetRadiusScalars();
+  return NULL;
+}
+//----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetSplatKernel(int k)
+{
+  if (this->MIPPainter) this->MIPPainter->SetSplatKernel(k);
+  if (this->LODMIPPainter) this->LODMIPPainter->SetSplatKernel(k);
+}
+//----------------------------------------------------------------------------
+int vtkMIPRepresentation::GetSplatKernel()
+{
+  return this->MIPPainter->GetSplatKernel();
+}
+//----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetOperator(int op)
+{
+  if (this->MIPPainter) this->MIPPainter->SetOperator(op);
+  if (this->LODMIPPainter) this->LODMIPPainter->SetOperator(op);
+}
+//----------------------------------------------------------------------------
+int vtkMIPRepresentation::GetOperator()
+{
+  return this->MIPPainter->GetOperator();
+}
+//----------------------------------------------------------------------------
+void vtkMIPRepresentation::SetWeightScalars(const char *s)
+{
+  s = vtkMIPRepresentation_ArrayName(s);
+  if (this->MIPPainter) this->MIPPainter->SetWeightScalars(s);
+  if (this->LODMIPPainter) this->LODMIPPainter->SetWeightScalars(s);
+}
+//----------------------------------------------------------------------------
+const char *vtkMIPRepresentation::GetWeightScalars()
+{
+  if (this->MIPPainter) return this->MIPPainter->GetWeightScalars();
+  return NULL;
+}
+//----------------------------------------------------------------------------
 
 
 //----------------------------------------------------------------------------
@@ -15,7 +15,10 @@
 // .NAME vtkMIPRepresentation
 // .SECTION Description
 // vtkMIPRepresentation is a representation that uses the vtkMIPMapper
-// for rendering glyphs.
+// for rendering glyphs. Point sets and composite datasets of point sets are
+// accepted, all the blocks are drawn into one image (see vtkMIPPainter).
+// Polydata without lines or polygons (e.g. vtkMIPMappedParticleSource)
+// bypasses the geometry filter, its arrays reach the painter uncopied.
 
 #ifndef __vtkMIPRepresentation_h
 #define __vtkMIPRepresentation_h
@@ -26,6 +29,7 @@
 
 class vtkMIPPainter;
 class vtkMIPDefaultPainter;
+class vtkMIPMortonSort;
 
 class VTK_EXPORT vtkMIPRepresentation : public vtkGeometryRepresentation
 {
@@ -52,12 +56,99 @@ public:
   const char *GetTypeScalars();
   const char *GetActiveScalars();
 
+  // Description:
+  // Point array of smoothing lengths, particles are splatted over their
+  // footprint with the SplatKernel (0=top hat, 1=cubic spline, 2=gaussian),
+  // see vtkMIPPainter::SetRadiusScalars. "None" (or "") unsets it.
+  void   SetRadiusScalars(const char *);
+  const char *GetRadiusScalars();
+  void   SetSplatKernel(int k);
+  int    GetSplatKernel();
+
+  // Description:
+  // How the particles falling on a pixel are combined, 0=max, 1=min,
+  // 2=sum (column density), 3=mean (weighted by WeightScalars if set),
+  // 4=count, see vtkMIPPainter::SetOperator. A WeightScalars of "None"
+  // (or "") unsets it.
+  void   SetOperator(int op);
+  int    GetOperator();
+  void   SetWeightScalars(const char *);
+  const char *GetWeightScalars();
+
   void   SetTypeActive(int l);
   int    GetTypeActive();
 
+  // Description:
+  // Encoding of the images exchanged between processes for compositing
+  // 0=double, 1=float, 2=16 bit quantized over the global image range.
+  void   SetReductionPrecision(int p);
+  int    GetReductionPrecision();
+
+  // Description:
+  // How the images of all processes are combined 0=dense reduce,
+  // 1=sparse (only occupied pixels are sent), 2=binary swap,
+  // 3=pipelined (bands are reduced while the next ones are drawn).
+  void   SetCompositingMode(int m);
+  int    GetCompositingMode();
+
+  // Description:
+  // Cull particles with a k-d tree (frustum and max-value occlusion),
+  // see vtkMIPPainter::SetSpatialCulling.
+  void   SetSpatialCulling(int c);
+  int    GetSpatialCulling();
+
+  // Description:
+  // Bin the projected particles into screen tiles before writing them,
+  // see vtkMIPPainter::SetTileBinning.
+  void   SetTileBinning(int b);
+  int    GetTileBinning();
+
+  // Description:
+  // Record which particle each pixel of max and min images came from,
+  // see vtkMIPPainter::SetPickBuffers. The particle at pixel (x,y) of the
+  // last full resolution image (origin at the bottom left) is then given
+  // on process 0 by GetPickedPointId (-1 for an empty pixel), along with
+  // the process it lives on and its window depth (1 for an empty pixel).
+  void   SetPickBuffers(int p);
+  int    GetPickBuffers();
+  vtkIdType GetPickedPointId(int x, int y);
+  int    GetPickedProcessId(int x, int y);
+  double GetPickedDepth(int x, int y);
+
+  // Description:
+  // How the data is reduced for interactive (LOD) rendering,
+  // 0=quadric clustering (the default geometry decimator),
+  // 1=particle subsample : the LOD painter draws a stable random subsample
+  // of the full data sized to LODFrameBudget (milliseconds). Nothing asks
+  // for extra frames, so the subsample only grows when the view renders
+  // the LOD again with the same camera; the still render after the
+  // interaction draws all the particles with the full resolution painter.
+  void   SetLODMode(int m);
+  vtkGetMacro(LODMode, int);
+  void   SetLODFrameBudget(double ms);
+  double GetLODFrameBudget();
+
+  // Description:
+  // Sort the particles (and their arrays) along a Z-order curve once per
+  // data update, so that the projection writes to the image coherently.
+  void   SetMortonOrder(int m);
+  int    GetMortonOrder();
+
   // Gather all the settings in one call for feeding back to the gui display
   vtkStringArray *GetActiveParticleSettings();
 
+  // Description:
+  // Statistics of the last frame drawn (by either painter), as rows of
+  // name, min, max and average over processes, see
+  // vtkMIPPainter::GetFrameStatistics. Only valid on process 0.
+  vtkStringArray *GetFrameStatistics();
+
+  // Description:
+  // CSV file the statistics of every full resolution frame are appended
+  // to, none by default, see vtkMIPPainter::SetTimingLogFile.
+  void   SetTimingLogFile(const char *);
+  const char *GetTimingLogFile();
+
 //BTX
 protected:
   vtkMIPRepresentation();
@@ -79,14 +170,23 @@ protected:
   // in here.
   virtual int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*);
 
+  // Description:
+  // In particle subsample LOD mode the full data is handed to the view as
+  // LOD data instead of the decimator output.
+  virtual int ProcessViewRequest(vtkInformationRequestKey* request_type,
+    vtkInformation* inInfo, vtkInformation* outInfo);
+
   //
   vtkMIPPainter         *MIPPainter;
   vtkMIPPainter         *LODMIPPainter;
   vtkMIPDefaultPainter  *MIPDefaultPainter;
   vtkMIPDefaultPainter  *LODMIPDefaultPainter;
+  vtkMIPMortonSort      *MortonSort;
   //
   int                    ActiveParticleType;
+  int                    LODMode;
   vtkSmartPointer<vtkStringArray> Settings;
+  vtkSmartPointer<vtkStringArray> Statistics;
 
 private:
   vtkMIPRepresentation(const vtkMIPRepresentation&); // Not implemented
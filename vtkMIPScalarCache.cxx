@@ -0,0 +1,227 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMIPScalarCache.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkMIPScalarCache.h"
+
+#include "vtkDataArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+#include "vtkWeakPointer.h"
+#include "vtkVersionMacros.h"
+#if VTK_MAJOR_VERSION>7 || (VTK_MAJOR_VERSION==7 && VTK_MINOR_VERSION>=1)
+  #define VTK_MIP_HAVE_SOA
+  #include "vtkSOADataArrayTemplate.h"
+#endif
+//
+#include "MIPScalars.h"
+
+#include <vector>
+
+//----------------------------------------------------------------------------
+// Only a handful of arrays are alive at any time (the full and LOD inputs),
+// so a short list is all we need. Entries whose array has been deleted are
+// dropped on the next lookup.
+class vtkMIPScalarCache::vtkInternals
+{
+public:
+  struct Entry
+    {
+    vtkWeakPointer<vtkDataArray>    Array;
+    unsigned long                   ArrayMTime;
+    vtkIdType                       NumberOfTuples;
+    // the magnitudes, or the weighted values
+    vtkSmartPointer<vtkDoubleArray> Values;
+    // set for the entries of GetWeighted
+    bool                            Weighted;
+    vtkWeakPointer<vtkDataArray>    Weights;
+    unsigned long                   WeightsMTime;
+    };
+  std::vector<Entry> Entries;
+
+  // Description:
+  // The entry for array (and weights if weighted), NULL if there is none.
+  // Entries whose arrays have been deleted are dropped.
+  Entry *Find(vtkDataArray *array, bool weighted, vtkDataArray *weights)
+    {
+    for (size_t i=0; i<this->Entries.size(); ) {
+      Entry &e = this->Entries[i];
+      if ((!e.Weighted && !e.Array) || (e.Weighted && !e.Weights)) {
+        this->Entries.erase(this->Entries.begin()+i);
+      }
+      else {
+        i++;
+      }
+    }
+    for (size_t i=0; i<this->Entries.size(); i++) {
+      Entry &e = this->Entries[i];
+      if (e.Weighted==weighted && e.Array==array && (!weighted || e.Weights==weights)) {
+        return &e;
+      }
+    }
+    return NULL;
+    }
+};
+
+vtkStandardNewMacro(vtkMIPScalarCache);
+//----------------------------------------------------------------------------
+vtkMIPScalarCache::vtkMIPScalarCache()
+{
+  this->Internals = new vtkInternals;
+}
+//----------------------------------------------------------------------------
+vtkMIPScalarCache::~vtkMIPScalarCache()
+{
+  delete this->Internals;
+}
+//----------------------------------------------------------------------------
+void vtkMIPScalarCache::Clear()
+{
+  this->Internals->Entries.clear();
+}
+//----------------------------------------------------------------------------
+template <typename T>
+void vtkMIPScalarCache_Magnitude(vtkDataArray *array, T *, double *out)
+{
+  int C = array->GetNumberOfComponents();
+  vtkIdType N = array->GetNumberOfTuples();
+#ifdef VTK_MIP_HAVE_SOA
+  vtkSOADataArrayTemplate<T> *soa = vtkArrayDownCast< vtkSOADataArrayTemplate<T> >(array);
+  if (soa) {
+    std::vector<const T*> components(C);
+    for (int c=0; c<C; c++) {
+      components[c] = soa->GetComponentArrayPointer(c);
+    }
+    MIPComputeMagnitude(&components[0], C, N, out);
+    return;
+  }
+#endif
+  MIPComputeMagnitude(static_cast<const T*>(array->GetVoidPointer(0)), C, N, out);
+}
+//----------------------------------------------------------------------------
+vtkDoubleArray *vtkMIPScalarCache::GetMagnitude(vtkDataArray *array)
+{
+  if (!array) return NULL;
+  std::vector<vtkInternals::Entry> &entries = this->Internals->Entries;
+  vtkInternals::Entry *entry = this->Internals->Find(array, false, NULL);
+  if (entry &&
+      entry->ArrayMTime==array->GetMTime() &&
+      entry->NumberOfTuples==array->GetNumberOfTuples())
+  {
+    return entry->Values;
+  }
+  if (!entry) {
+    entries.push_back(vtkInternals::Entry());
+    entry = &entries.back();
+    entry->Array = array;
+    entry->Values = vtkSmartPointer<vtkDoubleArray>::New();
+    entry->Weighted = false;
+    entry->WeightsMTime = 0;
+  }
+  //
+  // (re)compute
+  //
+  vtkIdType N = array->GetNumberOfTuples();
+  entry->ArrayMTime = array->GetMTime();
+  entry->NumberOfTuples = N;
+  entry->Values->SetNumberOfTuples(N);
+  if (N>0) {
+    double *out = entry->Values->GetPointer(0);
+    switch (array->GetDataType()) {
+      vtkTemplateMacro(
+        vtkMIPScalarCache_Magnitude(array, static_cast<VTK_TT*>(NULL), out));
+      default:
+        vtkErrorMacro(<< "Cannot compute magnitude of " << array->GetDataTypeAsString() << " array");
+        entry->Values->FillComponent(0, 0.0);
+    }
+  }
+  return entry->Values;
+}
+//----------------------------------------------------------------------------
+template <typename T>
+void vtkMIPScalarCache_Multiply(vtkDataArray *array, T *, double *out)
+{
+  vtkIdType N = array->GetNumberOfTuples();
+#ifdef VTK_MIP_HAVE_SOA
+  vtkSOADataArrayTemplate<T> *soa = vtkArrayDownCast< vtkSOADataArrayTemplate<T> >(array);
+  if (soa) {
+    MIPMultiplyValues(soa->GetComponentArrayPointer(0), 1, N, out);
+    return;
+  }
+#endif
+  MIPMultiplyValues(static_cast<const T*>(array->GetVoidPointer(0)),
+    array->GetNumberOfComponents(), N, out);
+}
+//----------------------------------------------------------------------------
+vtkDoubleArray *vtkMIPScalarCache::GetWeighted(vtkDataArray *array, vtkDataArray *weights)
+{
+  if (!weights) return NULL;
+  vtkIdType N = weights->GetNumberOfTuples();
+  // the magnitudes are looked up first, they may drop our entry from the list
+  vtkDataArray *values = (array && array->GetNumberOfComponents()>1) ?
+    this->GetMagnitude(array) : array;
+  vtkDataArray *factor = (weights->GetNumberOfComponents()>1) ?
+    this->GetMagnitude(weights) : weights;
+  std::vector<vtkInternals::Entry> &entries = this->Internals->Entries;
+  vtkInternals::Entry *entry = this->Internals->Find(array, true, weights);
+  unsigned long arrayMTime = array ? array->GetMTime() : 0;
+  if (entry &&
+      entry->ArrayMTime==arrayMTime &&
+      entry->WeightsMTime==weights->GetMTime() &&
+      entry->NumberOfTuples==N)
+  {
+    return entry->Values;
+  }
+  if (!entry) {
+    entries.push_back(vtkInternals::Entry());
+    entry = &entries.back();
+    entry->Array = array;
+    entry->Values = vtkSmartPointer<vtkDoubleArray>::New();
+    entry->Weighted = true;
+    entry->Weights = weights;
+  }
+  //
+  // (re)compute
+  //
+  entry->ArrayMTime = arrayMTime;
+  entry->WeightsMTime = weights->GetMTime();
+  entry->NumberOfTuples = N;
+  entry->Values->SetNumberOfTuples(N);
+  if (N>0) {
+    double *out = entry->Values->GetPointer(0);
+    if (!values || values->GetNumberOfTuples()!=N) {
+      entry->Values->FillComponent(0, 0.0);
+      return entry->Values;
+    }
+    entry->Values->FillComponent(0, 1.0);
+    vtkDataArray *factors[2] = { factor, values };
+    for (int f=0; f<2; f++) {
+      switch (factors[f]->GetDataType()) {
+        vtkTemplateMacro(
+          vtkMIPScalarCache_Multiply(factors[f], static_cast<VTK_TT*>(NULL), out));
+        default:
+          vtkErrorMacro(<< "Cannot weight with " << factors[f]->GetDataTypeAsString() << " array");
+          entry->Values->FillComponent(0, 0.0);
+          return entry->Values;
+      }
+    }
+  }
+  return entry->Values;
+}
+//----------------------------------------------------------------------------
+void vtkMIPScalarCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Cached arrays: " << this->Internals->Entries.size() << "\n";
+}
@@ -0,0 +1,73 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMIPScalarCache.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkMIPScalarCache - per-particle values derived from the scalars
+// .SECTION Description
+// When a multi-component array is used for the MIP, each particle is drawn
+// with the magnitude of its tuple. The magnitudes only change when the array
+// does, so they are computed once (in parallel) and kept here keyed on the
+// array and its MTime. One cache is shared by the full resolution and LOD
+// painters of a representation so that switching between them is free.
+// The products of the scalars with a weight array (mass weighted means)
+// are cached the same way.
+//
+// .SECTION See Also
+// vtkMIPPainter vtkMIPRepresentation
+
+#ifndef __vtkMIPScalarCache_h
+#define __vtkMIPScalarCache_h
+
+#include "vtkObject.h"
+
+class vtkDataArray;
+class vtkDoubleArray;
+
+class VTK_EXPORT vtkMIPScalarCache : public vtkObject
+{
+public:
+  static vtkMIPScalarCache* New();
+  vtkTypeMacro(vtkMIPScalarCache, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  // Description:
+  // Return the magnitude of every tuple of array. The result is recomputed
+  // only if array, its MTime or its size changed since it was last asked for.
+  vtkDoubleArray *GetMagnitude(vtkDataArray *array);
+
+  // Description:
+  // Return value*weight for every tuple, where value and weight are the
+  // magnitudes of the tuples of array and weights (their only component
+  // for scalars), as the painter draws them. array may be NULL (all values
+  // 0). Cached like the magnitudes, on both arrays.
+  vtkDoubleArray *GetWeighted(vtkDataArray *array, vtkDataArray *weights);
+
+  // Description:
+  // Discard all cached arrays.
+  void Clear();
+
+//BTX
+protected:
+   vtkMIPScalarCache();
+  ~vtkMIPScalarCache();
+
+  class vtkInternals;
+  vtkInternals *Internals;
+
+private:
+  vtkMIPScalarCache(const vtkMIPScalarCache&); // Not implemented.
+  void operator=(const vtkMIPScalarCache&); // Not implemented.
+//ETX
+};
+
+#endif